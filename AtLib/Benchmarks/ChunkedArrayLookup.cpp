@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <SDL2/SDL_timer.h>
+#include <Util/ChunkedArray.h>
+#include <Util/MemoryArena.h>
+#include <Util/Random.h>
+#include <Util/String.h>
+#include <stdio.h>
+
+// Compares looking up items in a ChunkedArray by walking its chunks, which is how it worked before it had
+// a chunk directory, with the directory lookup. The array is set up like a sector's power groups.
+
+// Roughly the shape of a PowerGroup, without the parts that need a City.
+struct BenchmarkPowerGroup {
+    s32 production;
+    s32 consumption;
+    s32 networkID;
+};
+
+template<typename T>
+static T& get_by_walking_chunks(ChunkedArray<T>& array, s32 index)
+{
+    s32 chunk_index = index / array.itemsPerChunk;
+    ArrayChunk<T>* chunk = array.firstChunk;
+    while (chunk_index > 0) {
+        chunk_index--;
+        chunk = chunk->nextChunk;
+    }
+    return chunk->items[index % array.itemsPerChunk];
+}
+
+static double ticks_to_ns(u64 ticks)
+{
+    return static_cast<double>(ticks) * 1'000'000'000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+int main(int, char*[])
+{
+    MemoryArena arena { "ChunkedArrayLookup"_s };
+
+    // Same chunk size as PowerLayer's power group pool.
+    s32 const items_per_chunk = 4;
+    s32 const lookup_count = 1'000'000;
+
+    for (s32 group_count : { 4, 16, 64, 256 }) {
+        ArrayChunkPool<BenchmarkPowerGroup> pool { arena, items_per_chunk };
+        ChunkedArray<BenchmarkPowerGroup> power_groups { pool };
+        for (s32 i = 0; i < group_count; i++)
+            power_groups.append({ .production = i, .consumption = 0, .networkID = 0 });
+
+        // Both loops look up the same sequence of groups.
+        Array<s32> group_ids = arena.allocate_array<s32>(lookup_count);
+        auto random = Random::create(12345);
+        for (s32 i = 0; i < lookup_count; i++)
+            group_ids.append(random->random_below(group_count));
+
+        s64 walked_sum = 0;
+        u64 walk_start = SDL_GetPerformanceCounter();
+        for (s32 i = 0; i < lookup_count; i++)
+            walked_sum += get_by_walking_chunks(power_groups, group_ids[i]).production;
+        u64 walk_ticks = SDL_GetPerformanceCounter() - walk_start;
+
+        s64 indexed_sum = 0;
+        u64 index_start = SDL_GetPerformanceCounter();
+        for (s32 i = 0; i < lookup_count; i++)
+            indexed_sum += power_groups.get(group_ids[i]).production;
+        u64 index_ticks = SDL_GetPerformanceCounter() - index_start;
+
+        if (walked_sum != indexed_sum) {
+            printf("Lookups disagree for %d power groups! Walking chunks: %lld, chunk directory: %lld\n",
+                group_count, static_cast<long long>(walked_sum), static_cast<long long>(indexed_sum));
+            return 1;
+        }
+
+        printf("%d power groups, %d lookups: walking chunks %.2fns each, chunk directory %.2fns each\n",
+            group_count, lookup_count,
+            ticks_to_ns(walk_ticks) / lookup_count,
+            ticks_to_ns(index_ticks) / lookup_count);
+    }
+
+    return 0;
+}
@@ -18,6 +18,8 @@
 #include <UI/Toast.h>
 #include <Util/Orientation.h>
 #include <Util/TokenReader.h>
+#include <mutex>
+#include <thread>
 
 static Console theConsole;
 
@@ -29,6 +31,15 @@ static Console theConsole;
 static SDL_LogOutputFunction default_logger;
 static void* default_logger_user_data;
 
+/*
+ * The console is only safe to touch from the main thread, so lines logged on other threads wait in
+ * here until updateAndRenderConsole() moves them across.
+ */
+static std::thread::id main_thread_id;
+static std::mutex pending_lines_mutex;
+static MemoryArena pending_lines_arena;
+static ChunkedArray<ConsoleOutputLine> pending_lines;
+
 void console_log_output_function(void* /*userdata*/, int category, SDL_LogPriority priority, char const* message)
 {
     default_logger(default_logger_user_data, category, priority, message);
@@ -50,9 +61,30 @@ void console_log_output_function(void* /*userdata*/, int category, SDL_LogPriori
         break;
     }
 
+    if (std::this_thread::get_id() != main_thread_id) {
+        std::lock_guard lock { pending_lines_mutex };
+        ConsoleOutputLine* line = pending_lines.appendBlank();
+        line->style = style;
+        line->text = pending_lines_arena.allocate_string(String::from_null_terminated(message));
+        return;
+    }
+
     consoleWriteLine(String::from_null_terminated(message), style);
 }
 
+static void write_pending_lines()
+{
+    std::lock_guard lock { pending_lines_mutex };
+    if (pending_lines.is_empty())
+        return;
+
+    for (auto it = pending_lines.iterate(); it.hasNext(); it.next())
+        consoleWriteLine(it.get().text, it.get().style);
+
+    pending_lines_arena.reset();
+    pending_lines = ChunkedArray<ConsoleOutputLine>(pending_lines_arena, 64);
+}
+
 void initConsole(MemoryArena* debugArena, float openHeight, float maximisedHeight, float openSpeed)
 {
     Console* console = &theConsole;
@@ -73,12 +105,17 @@ void initConsole(MemoryArena* debugArena, float openHeight, float maximisedHeigh
     console->register_default_commands();
 
     globalConsole = console;
+    main_thread_id = std::this_thread::get_id();
+    pending_lines_arena = MemoryArena { "ConsolePendingLines"_s };
+    pending_lines = ChunkedArray<ConsoleOutputLine>(pending_lines_arena, 64);
     SDL_LogGetOutputFunction(&default_logger, &default_logger_user_data);
     SDL_LogSetOutputFunction(&console_log_output_function, nullptr);
 }
 
 void updateAndRenderConsole(Console* console)
 {
+    write_pending_lines();
+
     bool scrollToBottom = false;
     auto& renderer = the_renderer();
 
@@ -1,32 +1,536 @@
 /*
- * Copyright (c) 2021-2025, Sam Atkins <sam@samatkins.co.uk>
+ * Copyright (c) 2021-2026, Sam Atkins <sam@samatkins.co.uk>
  *
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
 #include "BinaryFile.h"
+#include <Util/Maths.h>
 
-void rleDecode(u8* source, u8* dest, smm destSize)
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define RLE_BLOCK_SIZE 32
+#elif defined(__SSE2__)
+#    include <emmintrin.h>
+#    define RLE_BLOCK_SIZE 16
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define RLE_BLOCK_SIZE 16
+#else
+#    define RLE_BLOCK_SIZE 0
+#endif
+
+//
+// RLE works on whole blocks of bytes where it can. compareBytes() returns a mask with bit N set
+// if a[N] == b[N], for RLE_BLOCK_SIZE bytes. Without SIMD, there are no blocks, and everything
+// is done by the scalar loops that follow each block loop.
+//
+
+static constexpr smm rleBlockSize = RLE_BLOCK_SIZE;
+static constexpr smm rleMinRunLength = 4; // This is a fairly arbitrary number! Maybe it should be bigger, idk.
+
+#if defined(__AVX2__)
+static u32 compareBytes(u8 const* a, u8 const* b)
+{
+    __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a)), _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b)));
+    return (u32)_mm256_movemask_epi8(equal);
+}
+
+static void fillBlock(u8* dest, u8 value)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), _mm256_set1_epi8((char)value));
+}
+
+static void copyBlock(u8 const* source, u8* dest)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source)));
+}
+#elif defined(__SSE2__)
+static u32 compareBytes(u8 const* a, u8 const* b)
+{
+    __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a)), _mm_loadu_si128(reinterpret_cast<__m128i const*>(b)));
+    return (u32)_mm_movemask_epi8(equal);
+}
+
+static void fillBlock(u8* dest, u8 value)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_set1_epi8((char)value));
+}
+
+static void copyBlock(u8 const* source, u8* dest)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_loadu_si128(reinterpret_cast<__m128i const*>(source)));
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+static u32 compareBytes(u8 const* a, u8 const* b)
+{
+    // NEON has no movemask, so give each byte its own bit and add them up.
+    static constexpr u8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t equalBits = vandq_u8(vceqq_u8(vld1q_u8(a), vld1q_u8(b)), vld1q_u8(bits));
+    return (u32)vaddv_u8(vget_low_u8(equalBits)) | ((u32)vaddv_u8(vget_high_u8(equalBits)) << 8);
+}
+
+static void fillBlock(u8* dest, u8 value)
+{
+    vst1q_u8(dest, vdupq_n_u8(value));
+}
+
+static void copyBlock(u8 const* source, u8* dest)
+{
+    vst1q_u8(dest, vld1q_u8(source));
+}
+#endif
+
+#if RLE_BLOCK_SIZE
+static constexpr u32 rleFullBlockMask = (rleBlockSize >= 32) ? u32Max : ((1u << rleBlockSize) - 1);
+#endif
+
+// How many bytes from the start of `data` are the same as the first one, up to `maxLength`.
+static smm rleCountRunLength(u8 const* data, smm maxLength)
+{
+    smm length = 1;
+
+#if RLE_BLOCK_SIZE
+    // Compare each block against the one a byte earlier. Every byte matches its neighbour until the run ends.
+    for (; length + rleBlockSize <= maxLength; length += rleBlockSize) {
+        u32 differences = ~compareBytes(data + length, data + length - 1) & rleFullBlockMask;
+        if (differences != 0)
+            return length + count_trailing_zeros(differences);
+    }
+#endif
+
+    while ((length < maxLength) && (data[length] == data[0]))
+        length++;
+    return length;
+}
+
+// Finds the first position from `start` where rleMinRunLength identical bytes begin, or `sourceSize` if there isn't one.
+static smm rleFindRunStart(u8 const* source, smm start, smm sourceSize)
+{
+    static_assert(rleMinRunLength == 4, "rleFindRunStart() only checks 4 bytes");
+    smm pos = start;
+
+#if RLE_BLOCK_SIZE
+    // A run starts at N if bytes N to N+2 each equal the next one along. The last load ends at pos + rleBlockSize + 3.
+    for (; pos + rleBlockSize + rleMinRunLength - 1 <= sourceSize; pos += rleBlockSize) {
+        u32 runStarts = compareBytes(source + pos, source + pos + 1)
+            & compareBytes(source + pos + 1, source + pos + 2)
+            & compareBytes(source + pos + 2, source + pos + 3);
+        if (runStarts != 0)
+            return pos + count_trailing_zeros(runStarts);
+    }
+#endif
+
+    for (; pos + rleMinRunLength <= sourceSize; pos++) {
+        if (source[pos] == source[pos + 1] && source[pos] == source[pos + 2] && source[pos] == source[pos + 3])
+            return pos;
+    }
+    return sourceSize;
+}
+
+smm rleEncode(u8 const* source, smm sourceSize, u8* dest, smm destSize)
+{
+    // Our scheme is, (s8 length, u8...data)
+    // Positive length = repeat the next byte `length` times.
+    // Negative length = copy the next `-length` bytes literally.
+
+    smm destPos = 0;
+    smm literalStart = 0;
+
+    auto outputLiterals = [&](smm literalEnd) {
+        while (literalStart < literalEnd) {
+            smm literalCount = min<smm>(literalEnd - literalStart, s8Max);
+            if (destPos + 1 + literalCount > destSize)
+                return false;
+
+            dest[destPos++] = (u8)(s8)-literalCount;
+            copyMemory(source + literalStart, dest + destPos, literalCount);
+            destPos += literalCount;
+            literalStart += literalCount;
+        }
+        return true;
+    };
+
+    smm pos = 0;
+    while (pos < sourceSize) {
+        // Anything before the next run is too short to be worth it, so leave it as literals.
+        pos = rleFindRunStart(source, pos, sourceSize);
+        if (pos == sourceSize)
+            break;
+
+        smm runLength = rleCountRunLength(source + pos, min<smm>(sourceSize - pos, s8Max));
+
+        if (!outputLiterals(pos) || (destPos + 2 > destSize))
+            return -1;
+
+        dest[destPos++] = (u8)runLength;
+        dest[destPos++] = source[pos];
+        pos += runLength;
+        literalStart = pos;
+    }
+
+    if (!outputLiterals(sourceSize))
+        return -1;
+
+    return destPos;
+}
+
+smm rleMaxEncodedSize(smm sourceSize)
 {
-    u8* sourcePos = source;
+    // Worst case is all literals, which costs one length byte per s8Max bytes.
+    return sourceSize + ((sourceSize + s8Max - 1) / s8Max);
+}
+
+bool rleDecode(u8 const* source, smm sourceSize, u8* dest, smm destSize)
+{
+    u8 const* sourcePos = source;
+    u8 const* sourceEnd = source + sourceSize;
     u8* destPos = dest;
     u8* destEnd = dest + destSize;
 
+#if RLE_BLOCK_SIZE
+    // A span is at most s8Max bytes. When there's at least this much room after it, we can write
+    // (and read) whole blocks, and let the next span overwrite the excess.
+    smm const blockSlack = s8Max + rleBlockSize;
+#endif
+
     while (destPos < destEnd) {
-        s8 length = *((s8*)sourcePos);
+        if (sourceEnd - sourcePos < 2)
+            return false;
+
+        s8 length = *((s8 const*)sourcePos);
         sourcePos++;
         if (length < 0) {
             // Literals
-            s8 literalCount = -length;
-            copyMemory(sourcePos, destPos, literalCount);
+            smm literalCount = -(smm)length;
+            if ((literalCount > sourceEnd - sourcePos) || (literalCount > destEnd - destPos))
+                return false;
+
+#if RLE_BLOCK_SIZE
+            if ((sourceEnd - sourcePos >= blockSlack) && (destEnd - destPos >= blockSlack)) {
+                for (smm i = 0; i < literalCount; i += rleBlockSize)
+                    copyBlock(sourcePos + i, destPos + i);
+            } else
+#endif
+                copyMemory(sourcePos, destPos, literalCount);
             sourcePos += literalCount;
             destPos += literalCount;
         } else {
             // RLE
+            if ((length == 0) || (length > destEnd - destPos))
+                return false;
+
             u8 value = *sourcePos;
             sourcePos++;
-            fill_memory(destPos, value, length);
+#if RLE_BLOCK_SIZE
+            if (destEnd - destPos >= blockSlack) {
+                for (smm i = 0; i < length; i += rleBlockSize)
+                    fillBlock(destPos + i, value);
+            } else
+#endif
+                memset(destPos, value, length);
             destPos += length;
         }
     }
+
+    return true;
+}
+
+//
+// LZ is a byte-oriented LZ77 scheme, in the style of LZ4. Decoding is just copying bytes around,
+// so it's very quick, and it copes with data that's noisy on a per-byte basis but repeats at some
+// distance, which RLE can't do anything with. (eg, arrays of structs.)
+//
+// The data is a series of sequences, each of which is:
+//   u8 token: high 4 bits are the literal count, low 4 bits are (match length - lzMinMatchLength).
+//   [extra literal count bytes, if the literal count was 15]
+//   literals
+//   leU16 match offset: how far back from the current output position the match starts.
+//   [extra match length bytes, if the match length was 15]
+// An extended count is a series of bytes that are added on, continuing until one isn't 255.
+// The final sequence is literals only, with no match, and ends exactly at the end of the output.
+//
+
+static constexpr smm lzMinMatchLength = 4;
+static constexpr smm lzMaxMatchOffset = u16Max;
+static constexpr s32 lzHashBits = 14;
+
+static u32 lzReadU32(u8 const* pos)
+{
+    u32 result;
+    copyMemory(pos, (u8*)&result, sizeof(u32));
+    return result;
+}
+
+static u32 lzHash(u32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - lzHashBits);
+}
+
+static smm lzExtendedCountSize(smm count)
+{
+    return (count < 15) ? 0 : 1 + ((count - 15) / 255);
+}
+
+static u8* lzWriteExtendedCount(u8* destPos, smm count)
+{
+    if (count < 15)
+        return destPos;
+
+    count -= 15;
+    while (count >= 255) {
+        *destPos++ = 255;
+        count -= 255;
+    }
+    *destPos++ = (u8)count;
+    return destPos;
+}
+
+smm lzEncode(u8 const* source, smm sourceSize, u8* dest, smm destSize)
+{
+    // Most recent position where each hashed 4-byte sequence was seen, plus one so that 0 is "never".
+    u32 recentPositions[1 << lzHashBits];
+    fill_memory<u32>(recentPositions, 0, 1 << lzHashBits);
+
+    u8* destPos = dest;
+    u8* destEnd = dest + destSize;
+
+    // Writes the literals from `literalStart` up to `matchStart`, followed by the match.
+    // A matchLength of 0 means there's no match, which is only allowed for the final sequence.
+    auto outputSequence = [&](smm literalStart, smm matchStart, smm matchOffset, smm matchLength) {
+        smm literalCount = matchStart - literalStart;
+        smm matchCount = (matchLength > 0) ? (matchLength - lzMinMatchLength) : 0;
+
+        smm sequenceSize = 1 + lzExtendedCountSize(literalCount) + literalCount;
+        if (matchLength > 0)
+            sequenceSize += 2 + lzExtendedCountSize(matchCount);
+        if (sequenceSize > destEnd - destPos)
+            return false;
+
+        *destPos++ = (u8)((min<smm>(literalCount, 15) << 4) | min<smm>(matchCount, 15));
+        destPos = lzWriteExtendedCount(destPos, literalCount);
+        copyMemory(source + literalStart, destPos, literalCount);
+        destPos += literalCount;
+
+        if (matchLength > 0) {
+            *destPos++ = (u8)(matchOffset & 0xFF);
+            *destPos++ = (u8)(matchOffset >> 8);
+            destPos = lzWriteExtendedCount(destPos, matchCount);
+        }
+        return true;
+    };
+
+    smm literalStart = 0;
+    smm pos = 0;
+    while (pos + lzMinMatchLength <= sourceSize) {
+        u32 sequence = lzReadU32(source + pos);
+        u32 hash = lzHash(sequence);
+        smm candidate = (smm)recentPositions[hash] - 1;
+        recentPositions[hash] = (u32)(pos + 1);
+
+        if ((candidate < 0) || (pos - candidate > lzMaxMatchOffset) || (lzReadU32(source + candidate) != sequence)) {
+            // No match. The longer we've gone without one, the bigger steps we take, so that
+            // incompressible data doesn't cost too much time.
+            pos += 1 + ((pos - literalStart) >> 6);
+            continue;
+        }
+
+        smm matchLength = lzMinMatchLength;
+        while ((pos + matchLength < sourceSize) && (source[candidate + matchLength] == source[pos + matchLength]))
+            matchLength++;
+
+        if (!outputSequence(literalStart, pos, pos - candidate, matchLength))
+            return -1;
+
+        pos += matchLength;
+        literalStart = pos;
+    }
+
+    if (literalStart < sourceSize) {
+        if (!outputSequence(literalStart, sourceSize, 0, 0))
+            return -1;
+    }
+
+    return destPos - dest;
+}
+
+smm lzMaxEncodedSize(smm sourceSize)
+{
+    // Worst case is a single sequence of all literals.
+    return 1 + lzExtendedCountSize(sourceSize) + sourceSize;
+}
+
+bool lzDecode(u8 const* source, smm sourceSize, u8* dest, smm destSize)
+{
+    u8 const* sourcePos = source;
+    u8 const* sourceEnd = source + sourceSize;
+    u8* destPos = dest;
+    u8* destEnd = dest + destSize;
+
+    auto readExtendedCount = [&](smm& count) {
+        if (count < 15)
+            return true;
+        u8 extra;
+        do {
+            if (sourcePos >= sourceEnd)
+                return false;
+            extra = *sourcePos++;
+            count += extra;
+        } while (extra == 255);
+        return true;
+    };
+
+    while (destPos < destEnd) {
+        if (sourcePos >= sourceEnd)
+            return false;
+        u8 token = *sourcePos++;
+
+        smm literalCount = token >> 4;
+        if (!readExtendedCount(literalCount))
+            return false;
+        if ((literalCount > sourceEnd - sourcePos) || (literalCount > destEnd - destPos))
+            return false;
+        copyMemory(sourcePos, destPos, literalCount);
+        sourcePos += literalCount;
+        destPos += literalCount;
+
+        if (destPos == destEnd)
+            break;
+
+        if (sourceEnd - sourcePos < 2)
+            return false;
+        smm matchOffset = sourcePos[0] | (sourcePos[1] << 8);
+        sourcePos += 2;
+
+        smm matchLength = token & 0xF;
+        if (!readExtendedCount(matchLength))
+            return false;
+        matchLength += lzMinMatchLength;
+
+        if ((matchOffset == 0) || (matchOffset > destPos - dest) || (matchLength > destEnd - destPos))
+            return false;
+
+        // The match may overlap what it's producing, which is how runs get encoded. So, copy it in
+        // pieces that never overlap: the distance between the start of the match and our output
+        // position doubles each time, so even a long run only takes a few copies.
+        u8 const* matchPos = destPos - matchOffset;
+        smm remainingLength = matchLength;
+        while (remainingLength > 0) {
+            smm copyLength = min<smm>(remainingLength, destPos - matchPos);
+            copyMemory(matchPos, destPos, copyLength);
+            destPos += copyLength;
+            remainingLength -= copyLength;
+        }
+    }
+
+    return destPos == destEnd;
+}
+
+static smm packedLength(smm length, s32 bitsPerValue)
+{
+    smm valuesPerByte = 8 / bitsPerValue;
+    return (length + valuesPerByte - 1) / valuesPerByte;
+}
+
+FileBlobFilterHeader applyBlobFilters(FileBlobFilters filters, u8 const* source, smm length, u8* dest, smm* filteredLength)
+{
+    FileBlobFilterHeader header = {};
+    header.bitsPerValue = 8;
+    header.transposeStride = 1;
+    header.rowLength = 0;
+
+    // Transpose
+    smm stride = filters.transposeStride;
+    if (stride > 1 && length >= stride) {
+        // Any partial struct at the end is left where it is.
+        smm structCount = length / stride;
+        for (smm byteIndex = 0; byteIndex < stride; byteIndex++) {
+            u8* column = dest + (byteIndex * structCount);
+            for (smm structIndex = 0; structIndex < structCount; structIndex++)
+                column[structIndex] = source[(structIndex * stride) + byteIndex];
+        }
+        copyMemory(source + (structCount * stride), dest + (structCount * stride), length - (structCount * stride));
+        header.transposeStride = (u8)stride;
+    } else {
+        copyMemory(source, dest, length);
+    }
+
+    // Row delta. Backwards, so that each row is subtracted from its original predecessor.
+    smm rowLength = filters.rowLength;
+    if (rowLength > 0 && rowLength < length) {
+        for (smm i = length - 1; i >= rowLength; i--)
+            dest[i] -= dest[i - rowLength];
+        header.rowLength = (u32)rowLength;
+    }
+
+    // Pack
+    *filteredLength = length;
+    if (filters.packValues && length > 0) {
+        u8 largestValue = 0;
+        for (smm i = 0; i < length; i++)
+            largestValue = max(largestValue, dest[i]);
+
+        s32 bitsPerValue = (largestValue < 2) ? 1 : (largestValue < 4) ? 2 : (largestValue < 16) ? 4 : 8;
+        if (bitsPerValue < 8) {
+            // Packing only ever shrinks the data, so this can safely go in-place.
+            smm valuesPerByte = 8 / bitsPerValue;
+            smm packedIndex = 0;
+            for (smm i = 0; i < length; i += valuesPerByte) {
+                u8 packed = 0;
+                for (smm j = 0; j < valuesPerByte && (i + j) < length; j++)
+                    packed |= dest[i + j] << (j * bitsPerValue);
+                dest[packedIndex++] = packed;
+            }
+            header.bitsPerValue = (u8)bitsPerValue;
+            *filteredLength = packedIndex;
+        }
+    }
+
+    return header;
+}
+
+smm blobFilteredLength(FileBlobFilterHeader const& header, smm length)
+{
+    if (header.bitsPerValue < 8)
+        return packedLength(length, header.bitsPerValue);
+    return length;
+}
+
+void undoBlobFilters(FileBlobFilterHeader const& header, u8 const* filtered, smm length, u8* dest, u8* scratch)
+{
+    // Unpack
+    s32 bitsPerValue = header.bitsPerValue;
+    if (bitsPerValue < 8) {
+        smm valuesPerByte = 8 / bitsPerValue;
+        u8 valueMask = (u8)low_bits_mask(bitsPerValue);
+        smm i = 0;
+        for (u8 const* packedPos = filtered; i < length; packedPos++) {
+            u8 packed = *packedPos;
+            for (smm j = 0; j < valuesPerByte && i < length; j++, i++) {
+                dest[i] = packed & valueMask;
+                packed >>= bitsPerValue;
+            }
+        }
+    } else if (filtered != dest) {
+        copyMemory(filtered, dest, length);
+    }
+
+    // Row delta
+    smm rowLength = header.rowLength;
+    if (rowLength > 0) {
+        for (smm i = rowLength; i < length; i++)
+            dest[i] += dest[i - rowLength];
+    }
+
+    // Transpose
+    smm stride = header.transposeStride;
+    if (stride > 1 && length >= stride) {
+        smm structCount = length / stride;
+        copyMemory(dest, scratch, structCount * stride);
+        for (smm byteIndex = 0; byteIndex < stride; byteIndex++) {
+            u8 const* column = scratch + (byteIndex * structCount);
+            for (smm structIndex = 0; structIndex < structCount; structIndex++)
+                dest[(structIndex * stride) + byteIndex] = column[structIndex];
+        }
+    }
 }
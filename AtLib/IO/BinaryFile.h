@@ -8,6 +8,7 @@
 
 #include <Util/Assert.h>
 #include <Util/Basic.h>
+#include <Util/BitArray.h>
 #include <Util/Endian.h>
 #include <Util/MemoryArena.h>
 #include <Util/String.h>
@@ -76,27 +77,45 @@ struct FileBlob {
     leU32 length;
     leU32 decompressedLength;
     leU32 relativeOffset;
-    leU32 compressionScheme; // FileBlobCompressionScheme
+    leU32 compressionScheme; // FileBlobCompressionScheme, maybe with FILE_BLOB_FILTERED_FLAG or FILE_BLOB_SECTOR_PATCH_FLAG
 };
 
 // FIXME: Make this smaller? We'd change the file format though.
 enum class FileBlobCompressionScheme : u32 {
     Uncompressed = 0,
     RLE_S8 = 1, // Negative numbers are literal lengths, positive are run lengths
+    LZ = 2,     // LZ77-style, see lzEncode()
 
-    //
-    // TODO: Several per-tile-data arrays here are stored as u8s, but they only have a small number
-    // of possible values. eg, zones are 0-3, or will be 0-10 if we add l/m/h densities. We could
-    // fit two of those into a single byte, instead of 1 byte each. For terrain we only have 0-2
-    // currently which would allow 4 tiles per byte! The downside is extra complexity, but also
-    // it would make it harder to compress the resulting data. RLE works better when there are fewer
-    // options, and eg for that terrain example, we'd going from 3 options to 81 options. Right now
-    // the terrain size is reduced from 16000 to under 600, which is around 25%... which is the same
-    // as the 4-tiles-per-byte system, but more complicated. So yeah, I don't know. To get the most
-    // out of it we'd want an extra RLE or other compression scheme, that works with partial bytes.
-    //
-    // - Sam, 12/11/2019
-    //
+    // Not a real scheme, and never written to a file! Asks appendBlob() to try every scheme, and
+    // keep whichever produces the smallest output.
+    Smallest = 0xFFFFFFFF,
+};
+
+// If this bit is set in FileBlob::compressionScheme, the blob's data starts with a
+// FileBlobFilterHeader, and the compressed data follows it.
+u32 const FILE_BLOB_FILTERED_FLAG = 0x100;
+u32 const FILE_BLOB_SCHEME_MASK = 0xFF;
+
+struct FileBlobFilterHeader {
+    leU8 bitsPerValue;    // 8 = not packed, or 1, 2 or 4
+    leU8 transposeStride; // 1 = not transposed
+    leU8 _pad[2];
+    leU32 rowLength; // 0 = no row delta
+};
+
+// If this bit is set in FileBlob::compressionScheme, the blob is a sector patch: it only holds some
+// square sectors of a 2D array of bytes, and gets written over an existing copy of that array.
+// Once decompressed, it's a FileSectorPatchHeader, then `sectorCount` leU32 sector indices, then
+// each of those sectors' bytes, row by row. Sectors on the right and bottom edges are cut short to
+// fit inside the array.
+u32 const FILE_BLOB_SECTOR_PATCH_FLAG = 0x200;
+
+struct FileSectorPatchHeader {
+    leU32 arrayWidth;
+    leU32 arrayHeight;
+    leU16 sectorSize;
+    leU16 _pad;
+    leU32 sectorCount;
 };
 
 struct FileString {
@@ -131,6 +150,51 @@ struct FileSectionHeader {
 
 #pragma pack(pop)
 
-// // Returns number of bytes written
-// smm rleEncode(u8 *source, smm sourceSize, u8 *dest, smm destSize);
-void rleDecode(u8* source, u8* dest, smm destSize);
+//
+// Filters rearrange a blob's data before it's compressed, so that it compresses better. Several
+// per-tile arrays only have a handful of possible values (eg, zones are 0-3, terrain types 0-2) so
+// those can be packed into a few bits each. Smooth fields like height compress much better once
+// each row is stored as the difference from the row above. And arrays of structs compress better
+// when each byte of the struct is stored together, instead of interleaved.
+// They're applied in the order: transpose, row delta, pack. Loading undoes them in reverse.
+//
+struct FileBlobFilters {
+    // Pack each byte into as few bits as fit every value. (1, 2 or 4.) If the values are too big,
+    // they're left as they are.
+    bool packValues { false };
+    // Store each row as its difference from the one before, where a row is this many bytes.
+    // (This is the PNG "up" filter.) 0 = off.
+    u32 rowLength { 0 };
+    // Treat the data as an array of structs this big, and store all the first bytes, then all
+    // the second bytes, and so on. 1 = off.
+    u8 transposeStride { 1 };
+
+    bool is_empty() const { return !packValues && rowLength == 0 && transposeStride <= 1; }
+};
+
+// Which sectors of a 2D array have changed, one bit per sector, numbered row by row. When the writer
+// is writing patches, appendBlob() only writes these sectors. See FILE_BLOB_SECTOR_PATCH_FLAG.
+struct FileChangedSectors {
+    BitArray const* sectors { nullptr };
+    s32 sectorSize { 0 };
+};
+
+// Applies the filters to `source`, writing the result to `dest`, which must be at least `length` bytes.
+// Returns the header describing which filters were actually applied, and sets `filteredLength`.
+FileBlobFilterHeader applyBlobFilters(FileBlobFilters filters, u8 const* source, smm length, u8* dest, smm* filteredLength);
+// How long the filtered data is for a blob with this header that's `length` bytes when unfiltered.
+smm blobFilteredLength(FileBlobFilterHeader const& header, smm length);
+// Undoes the filters, producing `length` bytes in `dest`. `scratch` must be at least `length` bytes.
+void undoBlobFilters(FileBlobFilterHeader const& header, u8 const* filtered, smm length, u8* dest, u8* scratch);
+
+// The encoders return the number of bytes written, or -1 if the output didn't fit in `destSize`.
+// The maxEncodedSize() functions return a `destSize` that's always big enough.
+smm rleEncode(u8 const* source, smm sourceSize, u8* dest, smm destSize);
+smm rleMaxEncodedSize(smm sourceSize);
+// Returns false if the data is corrupt, or doesn't decode to exactly `destSize` bytes.
+bool rleDecode(u8 const* source, smm sourceSize, u8* dest, smm destSize);
+
+smm lzEncode(u8 const* source, smm sourceSize, u8* dest, smm destSize);
+smm lzMaxEncodedSize(smm sourceSize);
+// Returns false if the data is corrupt, or doesn't decode to exactly `destSize` bytes.
+bool lzDecode(u8 const* source, smm sourceSize, u8* dest, smm destSize);
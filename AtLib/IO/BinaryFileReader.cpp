@@ -6,12 +6,14 @@
 
 #include "BinaryFileReader.h"
 #include <Util/Log.h>
+#include <Util/Maths.h>
 
 BinaryFileReader readBinaryFile(FileHandle* handle, FileIdentifier identifier, MemoryArena* arena)
 {
     BinaryFileReader reader = {};
     reader.arena = arena;
     reader.fileHandle = handle;
+    reader.fileMapping = mapFile(handle);
     reader.isValidFile = false;
 
     // Check this file is our format!
@@ -51,13 +53,26 @@ BinaryFileReader readBinaryFile(FileHandle* handle, FileIdentifier identifier, M
     return reader;
 }
 
+bool BinaryFileReader::hasSection(FileIdentifier sectionID) const
+{
+    if (!isValidFile)
+        return false;
+
+    for (auto const& it : toc) {
+        if (it.sectionID == sectionID)
+            return true;
+    }
+
+    return false;
+}
+
 bool BinaryFileReader::startSection(FileIdentifier sectionID, u8 supportedSectionVersion)
 {
     bool succeeded = false;
 
     if (isValidFile) {
         if (sectionID != currentSectionID) {
-            arena->revert_to(arenaResetState);
+            endSection();
 
             // Find the section in the TOC
             // FIXME: find_matching
@@ -70,11 +85,22 @@ bool BinaryFileReader::startSection(FileIdentifier sectionID, u8 supportedSectio
             }
 
             if (tocEntry != nullptr) {
-                // Read the whole section into memory
-                smm bytesToRead = sizeof(FileSectionHeader) + tocEntry->length;
-                currentSection = arena->allocate_blob(bytesToRead);
-                smm bytesRead = readData(fileHandle, tocEntry->offset, bytesToRead, currentSection.writable_data());
-                if (bytesRead == bytesToRead) {
+                smm sectionSize = sizeof(FileSectionHeader) + tocEntry->length;
+                bool sectionIsInMemory = false;
+                if (fileMapping.data() != nullptr) {
+                    // Point straight into the mapping
+                    if ((u64)tocEntry->offset + (u64)sectionSize <= fileMapping.size()) {
+                        currentSection = fileMapping.sub_blob(tocEntry->offset, sectionSize);
+                        sectionIsInMemory = true;
+                    }
+                } else {
+                    // Read the whole section into memory
+                    currentSection = arena->allocate_blob(sectionSize);
+                    smm bytesRead = readData(fileHandle, tocEntry->offset, sectionSize, currentSection.writable_data());
+                    sectionIsInMemory = (bytesRead == sectionSize);
+                }
+
+                if (sectionIsInMemory) {
                     currentSectionHeader = (FileSectionHeader*)currentSection.data();
 
                     // Check the version
@@ -96,6 +122,15 @@ bool BinaryFileReader::startSection(FileIdentifier sectionID, u8 supportedSectio
     return succeeded;
 }
 
+void BinaryFileReader::endSection()
+{
+    arena->revert_to(arenaResetState);
+
+    currentSectionID = 0;
+    currentSectionHeader = nullptr;
+    currentSection = {};
+}
+
 String BinaryFileReader::readString(FileString fileString)
 {
     if (isValidFile && currentSectionHeader != nullptr) {
@@ -109,33 +144,154 @@ bool BinaryFileReader::readBlob(FileBlob source, u8* dest, smm destSize)
 {
     bool succeeded = false;
 
-    if (source.decompressedLength <= destSize) {
-        if (source.decompressedLength < destSize) {
-            logWarn("Destination passed to readBlob() is larger than needed. (Need {0}, got {1})"_s, { formatInt(source.decompressedLength), formatInt(destSize) });
-        }
+    if (!isValidFile || currentSectionHeader == nullptr)
+        return false;
 
-        switch (static_cast<FileBlobCompressionScheme>(source.compressionScheme.value())) {
-        case FileBlobCompressionScheme::Uncompressed: {
-            copyMemory(sectionMemoryAt(source.relativeOffset), dest, source.length);
-            succeeded = true;
-        } break;
+    if ((u64)source.relativeOffset + (u64)source.length > currentSectionHeader->length) {
+        logError("Data blob runs past the end of section '{0}' in file '{1}'"_s, { to_string(currentSectionID), fileHandle->path });
+        return false;
+    }
 
-        case FileBlobCompressionScheme::RLE_S8: {
-            rleDecode(sectionMemoryAt(source.relativeOffset), dest, destSize);
-            succeeded = true;
-        } break;
+    if (source.compressionScheme & FILE_BLOB_SECTOR_PATCH_FLAG) {
+        logError("Data blob in section '{0}' in file '{1}' is a sector patch, so it can only be read into a 2D array!"_s, { to_string(currentSectionID), fileHandle->path });
+        return false;
+    }
 
-        default: {
-            logError("Failed to decode data blob from file: unrecognised encoding scheme! ({0})"_s, { formatInt(source.compressionScheme) });
-        } break;
-        }
-    } else {
+    if (source.decompressedLength > destSize) {
         logError("Destination passed to readBlob() is too small! (Need {0}, got {1})"_s, { formatInt(source.decompressedLength), formatInt(destSize) });
+        return false;
+    }
+    if (source.decompressedLength < destSize) {
+        logWarn("Destination passed to readBlob() is larger than needed. (Need {0}, got {1})"_s, { formatInt(source.decompressedLength), formatInt(destSize) });
+    }
+
+    u8 const* data = sectionMemoryAt(source.relativeOffset);
+    smm dataLength = source.length;
+    smm decompressedLength = source.decompressedLength;
+    u32 scheme = source.compressionScheme;
+
+    // Filtered blobs start with a header, saying which filters to undo after decompressing.
+    Optional<FileBlobFilterHeader> filterHeader;
+    if (scheme & FILE_BLOB_FILTERED_FLAG) {
+        if (dataLength < (smm)sizeof(FileBlobFilterHeader)) {
+            logError("Failed to decode data blob from file '{0}': it's too short to contain its filter header!"_s, { fileHandle->path });
+            return false;
+        }
+        FileBlobFilterHeader header = *(FileBlobFilterHeader const*)data;
+        data += sizeof(FileBlobFilterHeader);
+        dataLength -= sizeof(FileBlobFilterHeader);
+
+        u8 bitsPerValue = header.bitsPerValue;
+        if ((bitsPerValue != 1 && bitsPerValue != 2 && bitsPerValue != 4 && bitsPerValue != 8) || header.transposeStride == 0) {
+            logError("Failed to decode data blob from file '{0}': its filter header is corrupt!"_s, { fileHandle->path });
+            return false;
+        }
+
+        filterHeader = header;
+        scheme &= FILE_BLOB_SCHEME_MASK;
+    }
+
+    // Packed data is longer once it's unpacked, so it needs decompressing somewhere else first.
+    // Other filters can be undone in-place.
+    smm decodedLength = decompressedLength;
+    u8* decoded = dest;
+    if (filterHeader.has_value()) {
+        decodedLength = blobFilteredLength(filterHeader.value(), decompressedLength);
+        if (decodedLength != decompressedLength)
+            decoded = arena->allocate_blob(decodedLength).writable_data();
+    }
+
+    switch (static_cast<FileBlobCompressionScheme>(scheme)) {
+    case FileBlobCompressionScheme::Uncompressed: {
+        succeeded = (dataLength >= decodedLength);
+        if (succeeded)
+            copyMemory(data, decoded, decodedLength);
+        else
+            logError("Failed to read data blob from file '{0}': it's shorter than it claims to be!"_s, { fileHandle->path });
+    } break;
+
+    case FileBlobCompressionScheme::RLE_S8: {
+        succeeded = rleDecode(data, dataLength, decoded, decodedLength);
+        if (!succeeded)
+            logError("Failed to decode data blob from file '{0}': RLE data is corrupt!"_s, { fileHandle->path });
+    } break;
+
+    case FileBlobCompressionScheme::LZ: {
+        succeeded = lzDecode(data, dataLength, decoded, decodedLength);
+        if (!succeeded)
+            logError("Failed to decode data blob from file '{0}': LZ data is corrupt!"_s, { fileHandle->path });
+    } break;
+
+    default: {
+        logError("Failed to decode data blob from file: unrecognised encoding scheme! ({0})"_s, { formatInt(source.compressionScheme) });
+    } break;
+    }
+
+    if (succeeded && filterHeader.has_value()) {
+        u8* scratch = (filterHeader.value().transposeStride > 1) ? arena->allocate_blob(decompressedLength).writable_data() : nullptr;
+        undoBlobFilters(filterHeader.value(), decoded, decompressedLength, dest, scratch);
     }
 
     return succeeded;
 }
 
+bool BinaryFileReader::readSectorPatch(FileBlob source, u8* dest, u32 width, u32 height)
+{
+    // Decompress the whole patch, and then copy each sector into place
+    FileBlob patchBlob = source;
+    patchBlob.compressionScheme = source.compressionScheme & ~FILE_BLOB_SECTOR_PATCH_FLAG;
+    smm patchLength = source.decompressedLength;
+    u8* patch = arena->allocate_blob(patchLength).writable_data();
+    if (!readBlob(patchBlob, patch, patchLength))
+        return false;
+
+    auto fail = [&](StringView reason) {
+        logError("Failed to apply sector patch from file '{0}': {1}"_s, { fileHandle->path, reason });
+        return false;
+    };
+
+    if (patchLength < (smm)sizeof(FileSectorPatchHeader))
+        return fail("it's too short to contain its header!"_s);
+    FileSectorPatchHeader header = *(FileSectorPatchHeader const*)patch;
+    if (header.arrayWidth != width || header.arrayHeight != height)
+        return fail("it's for a different size of array!"_s);
+    s32 sectorSize = header.sectorSize;
+    if (sectorSize == 0)
+        return fail("its header is corrupt!"_s);
+
+    s32 sectorsWide = divideCeil((s32)width, sectorSize);
+    s32 totalSectorCount = sectorsWide * divideCeil((s32)height, sectorSize);
+    u32 sectorCount = header.sectorCount;
+    if (sectorCount > (u32)totalSectorCount)
+        return fail("it has too many sectors!"_s);
+
+    leU32 const* sectorIndices = (leU32 const*)(patch + sizeof(FileSectorPatchHeader));
+    u8 const* tiles = (u8 const*)(sectorIndices + sectorCount);
+    u8 const* patchEnd = patch + patchLength;
+    if (tiles > patchEnd)
+        return fail("it's too short to contain its sector list!"_s);
+
+    for (u32 i = 0; i < sectorCount; i++) {
+        u32 sectorIndex = sectorIndices[i];
+        if (sectorIndex >= (u32)totalSectorCount)
+            return fail("it contains a sector outside the array!"_s);
+
+        s32 left = (sectorIndex % sectorsWide) * sectorSize;
+        s32 top = (sectorIndex / sectorsWide) * sectorSize;
+        s32 sectorWidth = min(sectorSize, (s32)width - left);
+        s32 sectorHeight = min(sectorSize, (s32)height - top);
+        if (patchEnd - tiles < (smm)sectorWidth * sectorHeight)
+            return fail("it's shorter than its sector list says!"_s);
+
+        for (s32 y = top; y < top + sectorHeight; y++) {
+            copyMemory(tiles, dest + (y * width) + left, sectorWidth);
+            tiles += sectorWidth;
+        }
+    }
+
+    return true;
+}
+
 u8* BinaryFileReader::sectionMemoryAt(smm relativeOffset)
 {
     return currentSection.writable_data() + sizeof(FileSectionHeader) + relativeOffset;
@@ -11,7 +11,10 @@
 #include <Util/Flags.h>
 #include <Util/MemoryArena.h>
 
-// TODO: @Size Maybe we keep a buffer the size of the largest section in the
+// Where the platform lets us, the file is memory-mapped and each section is just a view into the
+// mapping, so nothing gets copied until the caller asks for it. Otherwise, each section is read
+// into `arena` when it's started.
+// TODO: @Size In the fallback case, maybe we keep a buffer the size of the largest section in the
 // file, to reduce how much memory we have to allocate. Though, that assumes
 // we only ever need one section in memory at a time.
 struct BinaryFileReader {
@@ -28,6 +31,7 @@ struct BinaryFileReader {
 
     // Data about the file itself
     FileHandle* fileHandle;
+    Blob fileMapping; // Empty if we couldn't map the file
     bool isValidFile;
     Flags<Problems> problems;
 
@@ -42,6 +46,11 @@ struct BinaryFileReader {
     // Methods
 
     bool startSection(FileIdentifier sectionID, u8 supportedSectionVersion);
+    // Like startSection(), but doesn't complain if the section isn't there.
+    bool hasSection(FileIdentifier sectionID) const;
+    // Releases the current section's memory, along with anything else allocated from `arena` since
+    // it started. Any pointers into the section are invalid after this!
+    void endSection();
 
     template<typename T>
     T* readStruct(smm relativeOffset)
@@ -78,6 +87,25 @@ struct BinaryFileReader {
         return succeeded;
     }
 
+    // Returns a view of the array inside the current section, without copying it.
+    // NB: Only valid until the next startSection() call!
+    template<typename T>
+    Optional<ReadonlySpan<T>> readArray(FileArray source)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        if (!isValidFile || currentSectionHeader == nullptr)
+            return {};
+
+        u64 endPosition = (u64)source.relativeOffset + ((u64)source.count * sizeof(T));
+        if (endPosition > currentSectionHeader->length) {
+            logError("Array of '{0}', length {1}, runs past the end of section '{2}' in file '{3}'"_s, { typeNameOf<T>(), formatInt(source.count), to_string(currentSectionID), fileHandle->path });
+            return {};
+        }
+
+        return ReadonlySpan<T> { source.count, (T const*)sectionMemoryAt(source.relativeOffset) };
+    }
+
     String readString(FileString fileString);
 
     // readBlob() functions return whether it succeeded
@@ -96,9 +124,15 @@ struct BinaryFileReader {
         return succeeded;
     }
 
+    // If `source` is a sector patch, only the sectors it contains are written to `dest`.
     template<typename T>
     bool readBlob(FileBlob source, Array2<T>* dest)
     {
+        if constexpr (sizeof(T) == 1) {
+            if (source.compressionScheme & FILE_BLOB_SECTOR_PATCH_FLAG)
+                return readSectorPatch(source, (u8*)dest->items, dest->width(), dest->height());
+        }
+
         smm destSize = dest->count() * sizeof(T);
 
         return readBlob(source, (u8*)dest->items, destSize);
@@ -106,6 +140,7 @@ struct BinaryFileReader {
 
     // Internal
     u8* sectionMemoryAt(smm relativeOffset);
+    bool readSectorPatch(FileBlob source, u8* dest, u32 width, u32 height);
 };
 
 BinaryFileReader readBinaryFile(FileHandle* handle, FileIdentifier identifier, MemoryArena* arena);
@@ -5,8 +5,13 @@
  */
 
 #include "BinaryFileWriter.h"
+#include <Debug/Debug.h>
+#include <SDL2/SDL_timer.h>
 #include <Util/Enum.h>
 #include <Util/Log.h>
+#include <Util/Maths.h>
+#include <atomic>
+#include <thread>
 
 BinaryFileWriter startWritingFile(FileIdentifier identifier, u8 version, MemoryArena* arena)
 {
@@ -15,6 +20,7 @@ BinaryFileWriter startWritingFile(FileIdentifier identifier, u8 version, MemoryA
     writer.buffer.init(4_KB, arena);
 
     writer.fileHeaderLoc = writer.buffer.reserve<FileHeader>();
+    writer.deferredBlobs = ChunkedArray<BinaryFileWriter::DeferredBlob> { *arena, 16 };
 
     FileHeader fileHeader = {};
     fileHeader.identifier = identifier;
@@ -55,86 +61,149 @@ s32 BinaryFileWriter::getSectionRelativeOffset()
     return buffer.getCurrentPosition() - startOfSectionData;
 }
 
-FileBlob BinaryFileWriter::appendBlob(s32 length, u8 const* data, FileBlobCompressionScheme scheme)
+void BinaryFileWriter::appendBlob(FileBlob* destination, s32 length, u8 const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters)
 {
-    FileBlob result = {};
-    result.compressionScheme = to_underlying(scheme);
-    result.relativeOffset = getSectionRelativeOffset();
-    result.decompressedLength = length;
+    appendOrDeferBlob(destination, length, data, scheme, filters, 0);
+}
 
-    switch (scheme) {
-    case FileBlobCompressionScheme::Uncompressed: {
-        buffer.appendBytes(length, data);
-        result.length = length;
-    } break;
+void BinaryFileWriter::appendBlob(FileBlob* destination, Array2<u8> const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters, FileChangedSectors changedSectors)
+{
+    if (writeSectorPatches && changedSectors.sectors)
+        return appendSectorPatch(destination, data->width(), data->height(), data->items, changedSectors, scheme);
 
-    case FileBlobCompressionScheme::RLE_S8: {
-
-        // Our scheme is, (s8 length, u8...data)
-        // Positive length = repeat the next byte `length` times.
-        // Negative length = copy the next `-length` bytes literally.
-
-        s32 const minRunLength = 4; // This is a fairly arbitrary number! Maybe it should be bigger, idk.
-
-        u8 const* end = data + length;
-        u8 const* pos = data;
-        s32 remainingLength = length;
-
-        while (pos < end) {
-            // Detect if this is a run
-            s8 runLength = countRunLength(min(remainingLength, s8Max), pos);
-            if (runLength >= minRunLength) {
-                // Output the run!
-                buffer.append<s8>(&runLength);
-                buffer.append<u8>(pos);
-
-                pos += runLength;
-                remainingLength -= runLength;
-            } else {
-                // This is literals!
-                s32 literalLength = 0;
-
-                // We detect the end of the literals by repeatedly testing if the next bytes are a run
-                runLength = countRunLength(min(remainingLength, s8Max), pos + literalLength);
-                while ((runLength < minRunLength)
-                    && (remainingLength > 0)) {
-                    literalLength += runLength;
-                    remainingLength -= runLength;
-                    runLength = countRunLength(min(remainingLength, s8Max), pos + literalLength);
-                }
-
-                // Output literals
-                s8 outputLength = truncate<s8>(-literalLength);
-                buffer.append<s8>(&outputLength);
-                buffer.appendBytes(literalLength, pos);
-                pos += literalLength;
-
-                // Also, if we did detect a run, output that too!
-                if (runLength >= minRunLength) {
-                    buffer.append<s8>(&runLength);
-                    buffer.append<u8>(pos);
-
-                    pos += runLength;
-                    remainingLength -= runLength;
-                }
-            }
+    appendBlob(destination, data->count(), data->items, scheme, filters);
+}
+
+void BinaryFileWriter::appendSectorPatch(FileBlob* destination, u32 width, u32 height, u8 const* data, FileChangedSectors changedSectors, FileBlobCompressionScheme scheme)
+{
+    BitArray const& sectors = *changedSectors.sectors;
+    s32 sectorSize = changedSectors.sectorSize;
+    s32 sectorsWide = divideCeil((s32)width, sectorSize);
+    ASSERT(sectors.size() == sectorsWide * divideCeil((s32)height, sectorSize));
+
+    // Edge sectors are smaller, so this is an upper bound
+    s32 sectorCount = sectors.set_bit_count();
+    smm maxPatchLength = sizeof(FileSectorPatchHeader) + (sectorCount * (sizeof(leU32) + (sectorSize * sectorSize)));
+    u8* patch = getScratch(sectorPatchScratch, maxPatchLength);
+
+    FileSectorPatchHeader header = {};
+    header.arrayWidth = width;
+    header.arrayHeight = height;
+    header.sectorSize = (u16)sectorSize;
+    header.sectorCount = sectorCount;
+    copyMemory(&header, (FileSectorPatchHeader*)patch, 1);
+
+    leU32* sectorIndices = (leU32*)(patch + sizeof(FileSectorPatchHeader));
+    u8* tiles = (u8*)(sectorIndices + sectorCount);
+    for (s32 sectorIndex = sectors.find_next_set_bit(0); sectorIndex != -1; sectorIndex = sectors.find_next_set_bit(sectorIndex + 1)) {
+        *sectorIndices++ = sectorIndex;
+
+        s32 left = (sectorIndex % sectorsWide) * sectorSize;
+        s32 top = (sectorIndex / sectorsWide) * sectorSize;
+        s32 sectorWidth = min(sectorSize, (s32)width - left);
+        s32 sectorHeight = min(sectorSize, (s32)height - top);
+        for (s32 y = top; y < top + sectorHeight; y++) {
+            copyMemory(data + (y * width) + left, tiles, sectorWidth);
+            tiles += sectorWidth;
         }
+    }
 
-        result.length = getSectionRelativeOffset() - result.relativeOffset;
-    } break;
+    appendOrDeferBlob(destination, (s32)(tiles - patch), patch, scheme, {}, FILE_BLOB_SECTOR_PATCH_FLAG);
+}
 
-    default: {
-        logError("Called appendBlob() with an unrecognized scheme! ({0}) Defaulting to FileBlobCompressionScheme::Uncompressed."_s, { formatInt(scheme) });
-        result = appendBlob(length, data, FileBlobCompressionScheme::Uncompressed);
-    } break;
+void BinaryFileWriter::appendOrDeferBlob(FileBlob* destination, s32 length, u8 const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters, u32 compressionSchemeFlags)
+{
+    DEBUG_FUNCTION();
+
+    if (deferCompression) {
+        DeferredBlob* deferred = deferredBlobs.appendBlank();
+        u8* copy = arena->allocate_multiple<u8>(length).raw_data();
+        copyMemory(data, copy, length);
+        deferred->data = copy;
+        deferred->length = length;
+        deferred->scheme = scheme;
+        deferred->filters = filters;
+        deferred->compressionSchemeFlags = compressionSchemeFlags;
+        deferred->sectionStart = sectionHeaderRange.start;
+        deferred->destination = destination;
+        deferred->location = -1;
+
+        *destination = {};
+        return;
     }
 
+    u64 startTime = SDL_GetPerformanceCounter();
+
+    *destination = appendPreparedBlob(prepareBlob(length, data, scheme, filters, blobScratch), length, compressionSchemeFlags);
+
+    compressionStatistics.timeTaken += SDL_GetPerformanceCounter() - startTime;
+}
+
+BinaryFileWriter::PreparedBlob BinaryFileWriter::prepareBlob(s32 length, u8 const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters, BlobScratch& scratch)
+{
+    Optional<CompressedBlob> unfiltered;
+    if (filters.is_empty() || scheme == FileBlobCompressionScheme::Smallest)
+        unfiltered = compressBlob(scheme, length, data, scratch.compressed);
+
+    if (!filters.is_empty()) {
+        u8* filteredData = getScratch(scratch.filtered, length);
+        smm filteredLength;
+        FileBlobFilterHeader filterHeader = applyBlobFilters(filters, data, length, filteredData, &filteredLength);
+        CompressedBlob filtered = compressBlob(scheme, (s32)filteredLength, filteredData, scratch.filteredCompressed);
+
+        // Filters are only a guess at what will help, so if we're allowed to choose, check that they did.
+        if (!unfiltered.has_value() || (filtered.length + (smm)sizeof(FileBlobFilterHeader) < unfiltered.value().length))
+            return { filterHeader, filtered };
+    }
+
+    return { {}, unfiltered.value() };
+}
+
+void BinaryFileWriter::reserveBlobScratch(BlobScratch& scratch, s32 length, FileBlobFilters filters)
+{
+    // Enough for whatever compressBlob() and applyBlobFilters() ask for. Filtering never makes the data longer.
+    smm compressedSize = max(2 * (smm)length, rleMaxEncodedSize(length), lzMaxEncodedSize(length));
+    getScratch(scratch.compressed, compressedSize);
+    if (!filters.is_empty()) {
+        getScratch(scratch.filtered, length);
+        getScratch(scratch.filteredCompressed, compressedSize);
+    }
+}
+
+FileBlob BinaryFileWriter::appendPreparedBlob(PreparedBlob const& prepared, s32 decompressedLength, u32 compressionSchemeFlags)
+{
+    FileBlob result = {};
+    result.relativeOffset = getSectionRelativeOffset();
+    result.decompressedLength = decompressedLength;
+
+    if (prepared.filterHeader.has_value()) {
+        buffer.append(&prepared.filterHeader.value());
+        compressionSchemeFlags |= FILE_BLOB_FILTERED_FLAG;
+    }
+    buffer.appendBytes(prepared.compressed.length, prepared.compressed.data);
+    result.compressionScheme = to_underlying(prepared.compressed.scheme) | compressionSchemeFlags;
+    result.length = getSectionRelativeOffset() - result.relativeOffset;
+
+    compressionStatistics.blobCount++;
+    compressionStatistics.uncompressedBytes += decompressedLength;
+    compressionStatistics.compressedBytes += result.length;
+
     return result;
 }
 
-FileBlob BinaryFileWriter::appendBlob(Array2<u8> const* data, FileBlobCompressionScheme scheme)
+void BinaryFileWriter::resolveDeferredBlobs(void const* sectionStruct, s32 sectionStructSize)
 {
-    return appendBlob(data->count(), data->items, scheme);
+    // The section's blobs are the ones at the end of the list.
+    for (s32 index = deferredBlobs.count - 1; index >= 0; index--) {
+        DeferredBlob& deferred = deferredBlobs[index];
+        if (deferred.sectionStart != sectionHeaderRange.start)
+            break;
+
+        smm offset = (u8 const*)deferred.destination - (u8 const*)sectionStruct;
+        ASSERT(offset >= 0 && offset + (smm)sizeof(FileBlob) <= sectionStructSize); // The destination must be in the section struct!
+        deferred.location = startOfSectionData + (s32)offset;
+        deferred.destination = nullptr;
+    }
 }
 
 FileString BinaryFileWriter::append_string(StringView source)
@@ -148,6 +217,77 @@ FileString BinaryFileWriter::append_string(StringView source)
     return result;
 }
 
+void BinaryFileWriter::compressDeferredBlobs()
+{
+    // NB: No DEBUG_FUNCTION() here, as this may run on a worker thread, and the debug system isn't thread-safe.
+    u64 startTime = SDL_GetPerformanceCounter();
+    s32 blobCount = deferredBlobs.count;
+
+    // The arena isn't thread-safe, so give each blob all the scratch space it could need up front.
+    // Then the threads below never allocate.
+    for (s32 index = 0; index < blobCount; index++) {
+        DeferredBlob& deferred = deferredBlobs[index];
+        ASSERT(deferred.location != -1); // Every section must be ended first!
+        reserveBlobScratch(deferred.scratch, deferred.length, deferred.filters);
+    }
+
+    // Each blob is compressed on whichever thread gets to it first. This thread works too, instead of just waiting.
+    std::atomic<s32> nextBlobIndex { 0 };
+    auto worker = [&] {
+        for (s32 index = nextBlobIndex++; index < blobCount; index = nextBlobIndex++) {
+            DeferredBlob& deferred = deferredBlobs[index];
+            deferred.prepared = prepareBlob(deferred.length, deferred.data, deferred.scheme, deferred.filters, deferred.scratch);
+        }
+    };
+    s32 workerCount = min((s32)std::thread::hardware_concurrency(), blobCount);
+    Array<std::thread> workers = arena->allocate_array<std::thread>(max(workerCount - 1, 0));
+    for (s32 i = 1; i < workerCount; i++)
+        workers.append(std::thread(worker));
+    worker();
+    for (auto& thread : workers)
+        thread.join();
+
+    // Now that we know how long each blob is, copy the sections into a fresh buffer, with each section's
+    // blobs on the end. Everything else in a section is relative to its start, so apart from the
+    // blobs' own FileBlobs, only the section lengths and the TOC need updating.
+    WriteBuffer oldBuffer = buffer;
+    buffer.init(4_KB, arena);
+
+    FileHeader fileHeader = oldBuffer.readAt<FileHeader>(fileHeaderLoc);
+    WriteBufferLocation sectionStart = fileHeaderLoc.start + fileHeader.toc.relativeOffset + (fileHeader.toc.count * sizeof(FileTOCEntry));
+    buffer.appendBufferRange(oldBuffer, { 0, sectionStart });
+
+    s32 blobIndex = 0;
+    while (sectionStart < oldBuffer.byteCount) {
+        FileSectionHeader oldSectionHeader = oldBuffer.readAt<FileSectionHeader>(sectionStart);
+        s32 oldSectionLength = sizeof(FileSectionHeader) + oldSectionHeader.length;
+
+        sectionHeaderRange = buffer.appendBufferRange(oldBuffer, { sectionStart, oldSectionLength });
+        sectionHeaderRange.length = sizeof(FileSectionHeader);
+        startOfSectionData = sectionHeaderRange.start + sizeof(FileSectionHeader);
+
+        for (; blobIndex < blobCount && deferredBlobs[blobIndex].sectionStart == sectionStart; blobIndex++) {
+            DeferredBlob& deferred = deferredBlobs[blobIndex];
+            FileBlob fileBlob = appendPreparedBlob(deferred.prepared, deferred.length, deferred.compressionSchemeFlags);
+            buffer.overwriteAt(sectionHeaderRange.start + (deferred.location - sectionStart), sizeof(FileBlob), &fileBlob);
+        }
+
+        sectionHeader = oldSectionHeader;
+        sectionHeader.length = buffer.getLengthSince(startOfSectionData);
+        buffer.overwriteAt<FileSectionHeader>(sectionHeaderRange, &sectionHeader);
+
+        auto toc_entry = find_toc_entry(sectionHeader.identifier);
+        ASSERT(toc_entry.has_value());
+        setTOCEntry(toc_entry.value(), sectionHeaderRange.start, sectionHeader.length);
+
+        sectionStart += oldSectionLength;
+    }
+    ASSERT(blobIndex == blobCount);
+    deferredBlobs.clear();
+
+    compressionStatistics.timeTaken += SDL_GetPerformanceCounter() - startTime;
+}
+
 bool BinaryFileWriter::outputToFile(FileHandle* file)
 {
     // Check that the TOC entries are all filled-in
@@ -191,15 +331,93 @@ Optional<WriteBufferRange> BinaryFileWriter::find_toc_entry(FileIdentifier secti
     return {};
 }
 
-s8 BinaryFileWriter::countRunLength(s32 dataLength, u8 const* data)
+void BinaryFileWriter::setTOCEntry(WriteBufferRange tocEntryRange, WriteBufferLocation sectionStart, u32 sectionLength)
 {
-    s8 runLength = 1;
+    FileTOCEntry tocEntry = buffer.readAt<FileTOCEntry>(tocEntryRange);
+    tocEntry.offset = sectionStart;
+    tocEntry.length = sectionLength;
+    buffer.overwriteAt<FileTOCEntry>(tocEntryRange, &tocEntry);
+}
 
-    while ((runLength < dataLength)
-        && (runLength < s8Max)
-        && (data[runLength] == data[0])) {
-        runLength++;
+u8* BinaryFileWriter::getScratch(Blob& scratch, smm size)
+{
+    if ((smm)scratch.size() < size) {
+        // Grow generously, so that a series of increasingly large blobs doesn't waste lots of arena space.
+        scratch = arena->allocate_blob(max(size, 2 * (smm)scratch.size()));
     }
 
-    return runLength;
+    return scratch.writable_data();
+}
+
+BinaryFileWriter::CompressedBlob BinaryFileWriter::compressBlob(FileBlobCompressionScheme scheme, s32 length, u8 const* data, Blob& scratch)
+{
+    CompressedBlob result { FileBlobCompressionScheme::Uncompressed, data, length };
+
+    switch (scheme) {
+    case FileBlobCompressionScheme::Uncompressed:
+        break;
+
+    case FileBlobCompressionScheme::RLE_S8:
+    case FileBlobCompressionScheme::LZ: {
+        smm maxSize = (scheme == FileBlobCompressionScheme::RLE_S8) ? rleMaxEncodedSize(length) : lzMaxEncodedSize(length);
+        u8* compressed = getScratch(scratch, maxSize);
+        smm compressedLength = encodeBlob(scheme, length, data, compressed, maxSize);
+        ASSERT(compressedLength >= 0);
+
+        result = { scheme, compressed, compressedLength };
+    } break;
+
+    case FileBlobCompressionScheme::Smallest: {
+        if (length == 0)
+            break;
+
+        // Each attempt only gets as much room as the best output so far, minus one, so that a
+        // scheme that can't beat it gives up early instead of wasting time.
+        u8* scratchStart = getScratch(scratch, 2 * length);
+        u8* candidate = scratchStart;
+        for (auto candidateScheme : { FileBlobCompressionScheme::RLE_S8, FileBlobCompressionScheme::LZ }) {
+            smm candidateLength = encodeBlob(candidateScheme, length, data, candidate, result.length - 1);
+            if (candidateLength < 0)
+                continue;
+
+            result = { candidateScheme, candidate, candidateLength };
+
+            // Don't overwrite our best output with the next attempt
+            candidate = (candidate == scratchStart) ? (scratchStart + length) : scratchStart;
+        }
+    } break;
+
+    default: {
+        logError("Called appendBlob() with an unrecognized scheme! ({0}) Defaulting to FileBlobCompressionScheme::Uncompressed."_s, { formatInt(scheme) });
+    } break;
+    }
+
+    return result;
+}
+
+smm BinaryFileWriter::encodeBlob(FileBlobCompressionScheme scheme, s32 length, u8 const* data, u8* dest, smm destSize)
+{
+    switch (scheme) {
+    case FileBlobCompressionScheme::RLE_S8:
+        return rleEncode(data, length, dest, destSize);
+    case FileBlobCompressionScheme::LZ:
+        return lzEncode(data, length, dest, destSize);
+    default:
+        VERIFY_NOT_REACHED();
+    }
+}
+
+void BinaryFileWriter::logCompressionStatistics()
+{
+    auto& stats = compressionStatistics;
+    if (stats.blobCount == 0)
+        return;
+
+    double seconds = (double)stats.timeTaken / (double)SDL_GetPerformanceFrequency();
+    double ratio = (stats.compressedBytes > 0) ? ((double)stats.uncompressedBytes / (double)stats.compressedBytes) : 0.0;
+    double megabytesPerSecond = (seconds > 0) ? (((double)stats.uncompressedBytes / (1024.0 * 1024.0)) / seconds) : 0.0;
+
+    logInfo("Compressed {0} blobs from {1} to {2} bytes (ratio {3}:1) in {4}ms ({5} MB/s)"_s,
+        { formatInt(stats.blobCount), formatInt(stats.uncompressedBytes), formatInt(stats.compressedBytes),
+            formatFloat(ratio, 2), formatFloat(seconds * 1000.0, 2), formatFloat(megabytesPerSecond, 1) });
 }
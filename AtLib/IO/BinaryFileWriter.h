@@ -9,6 +9,7 @@
 #include <IO/BinaryFile.h>
 #include <IO/File.h>
 #include <IO/WriteBuffer.h>
+#include <Util/ChunkedArray.h>
 #include <Util/MemoryArena.h>
 
 struct BinaryFileWriter {
@@ -29,6 +30,33 @@ struct BinaryFileWriter {
     WriteBufferRange sectionHeaderRange;
     WriteBufferLocation startOfSectionData;
 
+    // If set, 2D arrays that come with a FileChangedSectors are written as sector patches, which
+    // only contain the sectors that changed. Otherwise, they're written in full.
+    bool writeSectorPatches;
+
+    // Blobs get filtered and compressed into these before they're appended to the buffer. They only grow.
+    // Each thread that's compressing needs its own, so deferred blobs get one each.
+    struct BlobScratch {
+        Blob filtered;
+        Blob compressed;
+        Blob filteredCompressed;
+    };
+    BlobScratch blobScratch;
+    Blob sectorPatchScratch;
+
+    // If set, appendBlob() only takes a copy of the data, and the filtering and compression wait until
+    // compressDeferredBlobs(). That's most of the work of writing a file, and by then it doesn't depend on
+    // anything outside the writer, so it can happen on another thread, with the blobs done in parallel.
+    bool deferCompression;
+
+    struct CompressionStatistics {
+        s32 blobCount;
+        s64 uncompressedBytes;
+        s64 compressedBytes;
+        u64 timeTaken; // In SDL_GetPerformanceCounter() ticks
+    };
+    CompressionStatistics compressionStatistics;
+
     // Methods
 
     void addTOCEntry(FileIdentifier sectionID);
@@ -90,22 +118,35 @@ struct BinaryFileWriter {
         return result;
     }
 
-    FileBlob appendBlob(s32 length, u8 const* data, FileBlobCompressionScheme scheme);
-    FileBlob appendBlob(Array2<u8> const* data, FileBlobCompressionScheme scheme);
+    // The destination is the blob's field in the section struct that's passed to endSection(). If compression
+    // is deferred, it's left empty here, and compressDeferredBlobs() fills in that field of the written section.
+    void appendBlob(FileBlob* destination, s32 length, u8 const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters = {});
+    void appendBlob(FileBlob* destination, Array2<u8> const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters = {}, FileChangedSectors changedSectors = {});
     template<Enum EnumT>
-    FileBlob appendBlob(Array2<EnumT> const& data, FileBlobCompressionScheme scheme)
+    void appendBlob(FileBlob* destination, Array2<EnumT> const& data, FileBlobCompressionScheme scheme, FileBlobFilters filters = {}, FileChangedSectors changedSectors = {})
     {
         // FIXME: Allow non-u8. Theoretically it'll work right now, but our compression scheme goes by individual bytes
         //        so we should do something smarter for larger types.
         static_assert(sizeof(EnumT) == 1);
-        return appendBlob(data.count(), reinterpret_cast<EnumUnderlyingType<EnumT>*>(data.items), scheme);
+        auto* bytes = reinterpret_cast<EnumUnderlyingType<EnumT>*>(data.items);
+        if (writeSectorPatches && changedSectors.sectors)
+            return appendSectorPatch(destination, data.width(), data.height(), bytes, changedSectors, scheme);
+        return appendBlob(destination, data.count(), bytes, scheme, filters);
     }
+    // Writes just the changed sectors of a 2D array of bytes. Filters don't apply, because the sectors
+    // aren't laid out like the array.
+    void appendSectorPatch(FileBlob* destination, u32 width, u32 height, u8 const* data, FileChangedSectors changedSectors, FileBlobCompressionScheme scheme);
 
     FileString append_string(StringView);
 
+    void logCompressionStatistics();
+
     template<typename T>
     void endSection(T* sectionStruct)
     {
+        if (deferCompression)
+            resolveDeferredBlobs(sectionStruct, sizeof(T));
+
         buffer.overwriteAt(startOfSectionData, sizeof(T), sectionStruct);
 
         // Update section header
@@ -114,17 +155,54 @@ struct BinaryFileWriter {
         buffer.overwriteAt<FileSectionHeader>(sectionHeaderRange, &sectionHeader);
 
         // Update TOC
-        FileTOCEntry tocEntry = buffer.readAt<FileTOCEntry>(sectionTOCRange);
-        tocEntry.offset = sectionHeaderRange.start;
-        tocEntry.length = sectionLength;
-        buffer.overwriteAt<FileTOCEntry>(sectionTOCRange, &tocEntry);
+        setTOCEntry(sectionTOCRange, sectionHeaderRange.start, sectionLength);
     }
 
+    // Compresses everything that appendBlob() deferred, and moves it into place. Every section must have
+    // been ended. Neither this nor the threads it starts use the debug system, so it's safe to call from a
+    // worker thread, as long as nothing else is using the writer or its arena.
+    void compressDeferredBlobs();
+
     bool outputToFile(FileHandle* file);
 
     // Internal
     Optional<WriteBufferRange> find_toc_entry(FileIdentifier sectionID);
-    s8 countRunLength(s32 dataLength, u8 const* data);
+    void setTOCEntry(WriteBufferRange tocEntryRange, WriteBufferLocation sectionStart, u32 sectionLength);
+    struct CompressedBlob {
+        FileBlobCompressionScheme scheme;
+        u8 const* data;
+        smm length;
+    };
+    CompressedBlob compressBlob(FileBlobCompressionScheme scheme, s32 length, u8 const* data, Blob& scratch);
+    smm encodeBlob(FileBlobCompressionScheme scheme, s32 length, u8 const* data, u8* dest, smm destSize);
+    u8* getScratch(Blob& scratch, smm size);
+
+    // A blob that's been filtered (maybe) and compressed, ready to append.
+    struct PreparedBlob {
+        Optional<FileBlobFilterHeader> filterHeader;
+        CompressedBlob compressed;
+    };
+    PreparedBlob prepareBlob(s32 length, u8 const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters, BlobScratch& scratch);
+    void reserveBlobScratch(BlobScratch& scratch, s32 length, FileBlobFilters filters);
+    FileBlob appendPreparedBlob(PreparedBlob const& prepared, s32 decompressedLength, u32 compressionSchemeFlags);
+    void appendOrDeferBlob(FileBlob* destination, s32 length, u8 const* data, FileBlobCompressionScheme scheme, FileBlobFilters filters, u32 compressionSchemeFlags);
+
+    struct DeferredBlob {
+        u8 const* data; // Our own copy
+        s32 length;
+        FileBlobCompressionScheme scheme;
+        FileBlobFilters filters;
+        u32 compressionSchemeFlags;
+
+        WriteBufferLocation sectionStart;
+        FileBlob const* destination; // Inside the section struct, which endSection() turns into the location.
+        WriteBufferLocation location; // Of its FileBlob, in the written section struct. -1 until endSection().
+
+        BlobScratch scratch;
+        PreparedBlob prepared;
+    };
+    ChunkedArray<DeferredBlob> deferredBlobs;
+    void resolveDeferredBlobs(void const* sectionStruct, s32 sectionStructSize);
 };
 
 BinaryFileWriter startWritingFile(FileIdentifier identifier, u8 version, MemoryArena* arena);
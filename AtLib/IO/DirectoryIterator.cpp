@@ -29,6 +29,7 @@ ErrorOr<FileInfo> DirectoryIterator::operator*() const
         .filename = String::from_null_terminated(m_data.dir_entry->d_name),
         .flags = {},
         .size = 0,
+        .modifiedTime = 0,
     };
 
     if (fstatat(m_data.dir_fd, m_data.dir_entry->d_name, &stat_buffer, 0) != 0) {
@@ -37,13 +38,14 @@ ErrorOr<FileInfo> DirectoryIterator::operator*() const
         return Error { error_message };
     }
 
-    if (stat_buffer.st_mode & S_IFDIR)
+    if (S_ISDIR(stat_buffer.st_mode))
         file_info.flags.add(FileFlags::Directory);
     if (file_info.filename[0] == '.')
         file_info.flags.add(FileFlags::Hidden);
     // TODO: ReadOnly flag, which... we never use!
 
     file_info.size = stat_buffer.st_size;
+    file_info.modifiedTime = ((s64)stat_buffer.st_mtim.tv_sec * 1'000'000'000) + stat_buffer.st_mtim.tv_nsec;
     return file_info;
 }
 
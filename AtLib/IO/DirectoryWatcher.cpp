@@ -7,6 +7,7 @@
 #include "DirectoryWatcher.h"
 #include <Util/ErrorOr.h>
 #include <Util/Log.h>
+#include <Util/MemoryArena.h>
 
 #if OS_LINUX
 #    include <cerrno>
@@ -62,9 +63,9 @@ DirectoryWatcher::~DirectoryWatcher()
 #endif
 }
 
-ErrorOr<bool> DirectoryWatcher::has_changed() const
-{
 #if OS_LINUX
+ErrorOr<smm> DirectoryWatcher::read_events(u8* buffer, smm buffer_size) const
+{
     pollfd fd_info {
         .fd = m_inotify_fd,
         .events = POLLIN,
@@ -74,7 +75,7 @@ ErrorOr<bool> DirectoryWatcher::has_changed() const
     auto result = poll(&fd_info, 1, 0);
     if (result == 0) {
         // Nothing happened.
-        return false;
+        return 0;
     }
 
     if (result < 0) {
@@ -87,9 +88,6 @@ ErrorOr<bool> DirectoryWatcher::has_changed() const
 
     ASSERT(fd_info.revents & POLLIN);
 
-    // TODO: Note which files changed, which we might want at some point?
-    auto constexpr buffer_size = 2048;
-    u8 buffer[buffer_size];
     auto read_result = read(m_inotify_fd, buffer, buffer_size);
     if (read_result < 0) {
         auto error_code = -errno;
@@ -100,7 +98,19 @@ ErrorOr<bool> DirectoryWatcher::has_changed() const
 
     // FIXME: Update recursive watchers to respond to newly added/removed directories.
 
-    return true;
+    return read_result;
+}
+#endif
+
+ErrorOr<bool> DirectoryWatcher::has_changed() const
+{
+#if OS_LINUX
+    alignas(inotify_event) u8 buffer[2048];
+    auto read_result = read_events(buffer, sizeof(buffer));
+    if (read_result.is_error())
+        return read_result.release_error();
+
+    return read_result.value() > 0;
 
 #elif OS_WINDOWS
     DWORD waitResult = WaitForSingleObject(m_handle, 0);
@@ -143,3 +153,54 @@ ErrorOr<bool> DirectoryWatcher::has_changed() const
     VERIFY_NOT_REACHED();
 #endif
 }
+
+ErrorOr<Array<DirectoryChange>> DirectoryWatcher::read_changes() const
+{
+#if OS_LINUX
+    // NB: If more events are waiting than fit in the buffer, the rest are picked up next time.
+    alignas(inotify_event) u8 buffer[4096];
+    auto read_result = read_events(buffer, sizeof(buffer));
+    if (read_result.is_error())
+        return read_result.release_error();
+
+    smm bytes_read = read_result.value();
+    Array<DirectoryChange> changes = temp_arena().allocate_array<DirectoryChange>(bytes_read / sizeof(inotify_event));
+
+    for (smm offset = 0; offset < bytes_read;) {
+        auto const* event = reinterpret_cast<inotify_event const*>(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+
+        // Overflows and changes to the directory itself don't name a file, so we can't say what changed.
+        if ((event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) || event->len == 0) {
+            changes.append({ DirectoryChange::Kind::Unknown, {} });
+            continue;
+        }
+
+        DirectoryChange::Kind kind;
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+            kind = DirectoryChange::Kind::Added;
+        } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            kind = DirectoryChange::Kind::Removed;
+        } else if (event->mask & IN_MODIFY) {
+            kind = DirectoryChange::Kind::Modified;
+        } else {
+            continue;
+        }
+
+        // NB: The name is null-padded to a multiple of the event size, so we can't just use event->len.
+        changes.append({ kind, temp_arena().allocate_string(String::from_null_terminated(event->name)) });
+    }
+
+    return changes;
+
+#else
+    auto has_changed = this->has_changed();
+    if (has_changed.is_error())
+        return has_changed.release_error();
+
+    Array<DirectoryChange> changes = temp_arena().allocate_array<DirectoryChange>(1);
+    if (has_changed.value())
+        changes.append({ DirectoryChange::Kind::Unknown, {} });
+    return changes;
+#endif
+}
@@ -6,11 +6,25 @@
 
 #pragma once
 
+#include <Util/Array.h>
 #include <Util/ErrorOr.h>
 #include <Util/OwnedPtr.h>
 #include <Util/Platform.h>
 #include <Util/String.h>
 
+struct DirectoryChange {
+    enum class Kind : u8 {
+        Added, // Created, or moved into the directory
+        Modified,
+        Removed, // Deleted, or moved out of the directory
+        Unknown, // Something changed, but we can't tell what, so treat everything as changed.
+        COUNT,
+    };
+
+    Kind kind;
+    String filename; // Relative to the watched directory. Empty for Unknown changes.
+};
+
 class DirectoryWatcher {
 public:
     static ErrorOr<OwnedRef<DirectoryWatcher>> watch(String path);
@@ -23,6 +37,10 @@ public:
     ~DirectoryWatcher();
 
     ErrorOr<bool> has_changed() const;
+    // Like has_changed(), but reports which files changed. Returns an empty array if nothing did.
+    // Only Linux can tell which files changed. Elsewhere, any change is reported as a single Unknown one.
+    // The array and filenames are allocated in temp memory.
+    ErrorOr<Array<DirectoryChange>> read_changes() const;
 
 private:
 #if OS_LINUX
@@ -31,6 +49,8 @@ private:
         , m_path(path)
     {
     }
+    // Reads whatever inotify events are waiting into `buffer`, and returns how many bytes that was.
+    ErrorOr<smm> read_events(u8* buffer, smm buffer_size) const;
     int m_inotify_fd;
 #elif OS_WINDOWS
     HANDLE m_change_handle;
@@ -13,6 +13,10 @@
 
 #if OS_LINUX
 #    include <cerrno>
+#    include <cstdio>
+#    include <cstring>
+#    include <fcntl.h>
+#    include <sys/mman.h>
 #    include <sys/stat.h>
 #    include <unistd.h>
 #elif OS_WINDOWS
@@ -129,6 +133,49 @@ void closeFile(FileHandle* file)
         SDL_RWclose(file->sdl_file);
         file->isOpen = false;
     }
+
+    if (file->mapping.data() != nullptr) {
+#if OS_LINUX
+        munmap(file->mapping.writable_data(), file->mapping.size());
+#endif
+        file->mapping = {};
+    }
+}
+
+FileHandle openFileForSyncedWrite(String path)
+{
+    ASSERT(path.is_null_terminated()); // openFileForSyncedWrite() path must be null-terminated.
+
+    FileHandle result = {};
+
+    result.path = path;
+    result.sdl_file = SDL_RWFromFile(path.raw_pointer_to_characters(), file_access_mode_strings[FileAccessMode::Write].raw_pointer_to_characters());
+    result.isOpen = (result.sdl_file != nullptr);
+
+    return result;
+}
+
+bool closeFileAndSync(FileHandle* file)
+{
+    if (!file->isOpen)
+        return false;
+
+    // SDL doesn't have a way to sync, so go around it to the file underneath.
+    bool synced = false;
+#if OS_LINUX
+    if (file->sdl_file->type == SDL_RWOPS_STDFILE) {
+        FILE* stdio_file = file->sdl_file->hidden.stdio.fp;
+        synced = (fflush(stdio_file) == 0) && (fsync(fileno(stdio_file)) == 0);
+    }
+#elif OS_WINDOWS
+    if (file->sdl_file->type == SDL_RWOPS_WINFILE)
+        synced = FlushFileBuffers(file->sdl_file->hidden.windowsio.h) != 0;
+#endif
+
+    bool closed = (SDL_RWclose(file->sdl_file) == 0);
+    file->isOpen = false;
+
+    return synced && closed;
 }
 
 s64 getFilePosition(FileHandle* file)
@@ -177,6 +224,59 @@ bool deleteFile(String path)
 #endif
 }
 
+Optional<FileInfo> getFileInfo(String path)
+{
+    ASSERT(path.is_null_terminated());
+
+    FileInfo result {
+        .filename = path,
+        .flags = {},
+        .size = 0,
+        .modifiedTime = 0,
+    };
+    if (auto last_slash = path.find('/', SearchFrom::End); last_slash.has_value())
+        result.filename = path.substring(last_slash.value() + 1).deprecated_to_string();
+    if (result.filename.starts_with('.'))
+        result.flags.add(FileFlags::Hidden);
+
+#if OS_LINUX
+    struct stat stat_buffer {};
+    if (stat(path.raw_pointer_to_characters(), &stat_buffer) != 0)
+        return {};
+
+    if (S_ISDIR(stat_buffer.st_mode))
+        result.flags.add(FileFlags::Directory);
+    result.size = stat_buffer.st_size;
+    result.modifiedTime = ((s64)stat_buffer.st_mtim.tv_sec * 1'000'000'000) + stat_buffer.st_mtim.tv_nsec;
+
+#elif OS_WINDOWS
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (GetFileAttributesEx(path.raw_pointer_to_characters(), GetFileExInfoStandard, &attributes) == 0)
+        return {};
+
+    if (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        result.flags.add(FileFlags::Directory);
+    result.size = ((smm)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    // FILETIMEs count 100ns intervals since 1601.
+    s64 file_time = ((s64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    result.modifiedTime = (file_time - 116'444'736'000'000'000) * 100;
+#endif
+
+    return result;
+}
+
+bool renameFile(String from, String to)
+{
+    ASSERT(from.is_null_terminated());
+    ASSERT(to.is_null_terminated());
+
+#if OS_LINUX
+    return rename(from.raw_pointer_to_characters(), to.raw_pointer_to_characters()) == 0;
+#elif OS_WINDOWS
+    return MoveFileEx(from.raw_pointer_to_characters(), to.raw_pointer_to_characters(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#endif
+}
+
 bool createDirectory(String path)
 {
     ASSERT(path.is_null_terminated());
@@ -305,6 +405,47 @@ smm readData(FileHandle* file, smm position, smm size, void* result)
     return bytesRead;
 }
 
+Blob mapFile(FileHandle* file)
+{
+    DEBUG_FUNCTION();
+
+    if (!file->isOpen)
+        return {};
+
+    if (file->mapping.data() != nullptr)
+        return file->mapping;
+
+#if OS_LINUX
+    ASSERT(file->path.is_null_terminated());
+
+    // SDL doesn't give us its file descriptor, so open our own. It's only needed until the
+    // mapping exists, which keeps the file alive by itself.
+    int fd = open(file->path.raw_pointer_to_characters(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return {};
+
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+        close(fd);
+        return {};
+    }
+
+    // MAP_PRIVATE so that PROT_WRITE only ever touches our own copy-on-write pages.
+    void* address = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        logWarn("Failed to map file '{0}' into memory: {1}"_s, { file->path, String::from_null_terminated(strerror(errno)) });
+        return {};
+    }
+
+    file->mapping = Blob { static_cast<size_t>(file_stat.st_size), static_cast<u8*>(address) };
+    return file->mapping;
+
+#else
+    return {};
+#endif
+}
+
 File readFile(FileHandle* handle, MemoryArena* arena)
 {
     DEBUG_FUNCTION();
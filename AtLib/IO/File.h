@@ -19,6 +19,9 @@ struct FileHandle {
     String path;
     bool isOpen;
     SDL_RWops* sdl_file;
+
+    // Set by mapFile(), and released by closeFile()
+    Blob mapping;
 };
 
 struct File {
@@ -50,6 +53,7 @@ struct FileInfo {
     String filename;
     Flags<FileFlags> flags;
     smm size;
+    s64 modifiedTime; // Nanoseconds since the Unix epoch
 };
 
 // Returns the part of 'filename' after the final '.'
@@ -66,9 +70,22 @@ Optional<StringView> get_file_locale_segment(StringView filename);
 
 FileHandle openFile(String path, FileAccessMode mode);
 void closeFile(FileHandle* file);
+// For writing a file that's about to be renamed into place. closeFileAndSync() makes sure everything that
+// was written has reached the disk (with fsync() or FlushFileBuffers()) before closing it, and returns
+// whether that all succeeded. Otherwise, a crash soon after the rename can leave the new name pointing
+// at a file whose data never got written.
+// Neither of these uses the debug system, so they're safe to call from worker threads.
+FileHandle openFileForSyncedWrite(String path);
+bool closeFileAndSync(FileHandle* file);
 smm getFileSize(FileHandle* file);
 s64 getFilePosition(FileHandle* file);
 bool deleteFile(String path);
+// Returns nothing if the file doesn't exist, or we can't read its info. Doesn't log anything.
+Optional<FileInfo> getFileInfo(String path);
+// Moves `from` to `to`, replacing any existing file there. On the same filesystem, this is atomic:
+// anyone opening `to` sees either the old file or the new one, never a mix.
+// Doesn't log anything, so it's safe to call from worker threads.
+bool renameFile(String from, String to);
 
 bool createDirectory(String path);
 
@@ -88,6 +105,12 @@ smm readFromFile(FileHandle* file, Blob& dest);
 // If there are fewer than `size` bytes remaining, reads all it can. Returns how many bytes were read.
 smm readData(FileHandle* file, smm position, smm size, void* result);
 
+// Maps the whole file into memory, so it can be read without any copying. Writes to the mapping
+// are private, and never reach the file. The mapping stays valid until closeFile() is called.
+// Returns an empty Blob if the file can't be mapped (or the platform doesn't support it), in
+// which case, use readData() instead.
+Blob mapFile(FileHandle* file);
+
 template<typename T>
 bool readStruct(FileHandle* file, smm position, T* result)
 {
@@ -6,6 +6,7 @@
 
 #include "WriteBuffer.h"
 #include <IO/File.h>
+#include <Util/Maths.h>
 #include <Util/MemoryArena.h>
 
 void WriteBuffer::init(s32 chunkSize_, MemoryArena* arena_)
@@ -55,6 +56,35 @@ WriteBufferRange WriteBuffer::appendBytes(s32 length, void const* bytes)
     return result;
 }
 
+WriteBufferRange WriteBuffer::appendBufferRange(WriteBuffer const& other, WriteBufferRange range)
+{
+    // Make sure the requested range is valid
+    ASSERT((range.start + range.length) <= other.byteCount);
+
+    WriteBufferRange result = {};
+    result.start = getCurrentPosition();
+    result.length = range.length;
+
+    // Find the chunk this starts in
+    WriteBufferChunk* chunk = other.firstChunk;
+    for (s32 chunkIndex = range.start / other.chunkSize; chunkIndex > 0; chunkIndex--)
+        chunk = chunk->nextChunk;
+    s32 posInChunk = range.start % other.chunkSize;
+
+    s32 remainingLength = range.length;
+    while (remainingLength > 0) {
+        s32 lengthToCopy = min(remainingLength, chunk->used - posInChunk);
+        appendBytes(lengthToCopy, chunk->bytes + posInChunk);
+        remainingLength -= lengthToCopy;
+
+        // Go to next chunk
+        chunk = chunk->nextChunk;
+        posInChunk = 0;
+    }
+
+    return result;
+}
+
 WriteBufferRange WriteBuffer::reserveBytes(s32 length)
 {
     WriteBufferRange result = {};
@@ -66,6 +66,7 @@ struct WriteBuffer {
     }
 
     WriteBufferRange appendBytes(s32 length, void const* bytes);
+    WriteBufferRange appendBufferRange(WriteBuffer const& other, WriteBufferRange range);
     WriteBufferRange reserveBytes(s32 length);
 
     WriteBufferLocation getCurrentPosition();
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Util/Basic.h>
+#include <Util/Memory.h>
+#include <Util/MemoryArena.h>
+#include <Util/Random.h>
+#include <Util/Span.h>
+
+// Makes `size` bytes, where byte i is get_byte(i).
+template<typename Callback>
+Span<u8> make_bytes(MemoryArena& arena, smm size, Callback&& get_byte)
+{
+    Span<u8> result = arena.allocate_multiple<u8>(size);
+    for (smm i = 0; i < size; i++)
+        result[i] = (u8)get_byte(i);
+    return result;
+}
+
+// Makes `size` random bytes, each less than value_limit.
+inline Span<u8> make_random_bytes(MemoryArena& arena, Random& random, smm size, s32 value_limit = 256)
+{
+    return make_bytes(arena, size, [&](smm) { return random.random_below(value_limit); });
+}
+
+// Gives decode() a buffer the size of the original to decode into, and checks that it succeeded and
+// got the original back.
+template<typename Decode>
+bool decodes_to_original(MemoryArena& arena, Span<u8> original, Decode&& decode)
+{
+    u8* decoded = arena.allocate_multiple<u8>(original.size()).raw_data();
+    return decode(decoded) && is_memory_equal(decoded, original.raw_data(), original.size());
+}
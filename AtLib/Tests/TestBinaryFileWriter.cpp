@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Harness/Harness.h"
+#include "Harness/TestData.h"
+#include <IO/BinaryFileReader.h>
+#include <IO/BinaryFileWriter.h>
+#include <Util/Maths.h>
+#include <Util/MemoryArena.h>
+#include <Util/String.h>
+
+#pragma pack(push, 1)
+struct TestSection_Mixed {
+    FileString name;
+    FileBlob rows;
+    FileArray numbers;
+    FileBlob noise;
+};
+struct TestSection_Tiles {
+    leU32 tileCount;
+    FileBlob patch;
+    FileBlob full;
+};
+struct TestSection_Empty {
+    leU32 value;
+};
+#pragma pack(pop)
+
+void test_main()
+{
+    MemoryArena arena { "TestBinaryFileWriter"_s };
+
+    auto random = Random::create(12345);
+
+    s32 const width = 70;
+    s32 const height = 50;
+    s32 const sector_size = 16;
+    s32 const sector_count = divideCeil(width, sector_size) * divideCeil(height, sector_size);
+
+    Span<u8> rows = make_bytes(arena, width * height, [&](smm i) { return (i % width) + (i / width); });
+    Span<u8> noise = make_random_bytes(arena, *random, 1000);
+    Array<leU32> numbers = arena.allocate_array<leU32>(10);
+    for (u32 i = 0; i < 10; i++)
+        numbers.append(i * i);
+
+    auto tiles = arena.allocate_array_2d<u8>(width, height);
+    for (s32 i = 0; i < width * height; i++)
+        tiles.items[i] = (u8)random->random_below(3);
+    BitArray changed_sectors { arena, sector_count };
+    changed_sectors.set_bit(0);
+    changed_sectors.set_bit(sector_count - 1);
+
+    // Writes the same file either way, but with deferred compression, the data is changed after it's
+    // appended, which mustn't affect what's saved.
+    auto write_file = [&](String path, bool defer_compression) {
+        BinaryFileWriter writer = startWritingFile("TEST"_id, 1, &arena);
+        writer.deferCompression = defer_compression;
+        writer.writeSectorPatches = true;
+        writer.addTOCEntry("MIXD"_id);
+        writer.addTOCEntry("TILE"_id);
+        writer.addTOCEntry("EMPT"_id);
+
+        Span<u8> rows_copy = arena.allocate_multiple<u8>(rows.size());
+        copyMemory(rows.raw_data(), rows_copy.raw_data(), rows.size());
+        auto tiles_copy = arena.allocate_array_2d<u8>(width, height);
+        copyMemory(tiles.items, tiles_copy.items, width * height);
+
+        writer.startSection<TestSection_Mixed>("MIXD"_id, 1);
+        TestSection_Mixed mixed = {};
+        mixed.name = writer.append_string("Hello"_s);
+        writer.appendBlob(&mixed.rows, rows_copy.size(), rows_copy.raw_data(), FileBlobCompressionScheme::Smallest, { .rowLength = width });
+        mixed.numbers = writer.appendArray(numbers);
+        writer.appendBlob(&mixed.noise, noise.size(), noise.raw_data(), FileBlobCompressionScheme::Smallest);
+        writer.endSection(&mixed);
+
+        writer.startSection<TestSection_Tiles>("TILE"_id, 1);
+        TestSection_Tiles tiles_section = {};
+        tiles_section.tileCount = width * height;
+        writer.appendBlob(&tiles_section.patch, &tiles_copy, FileBlobCompressionScheme::Smallest, {}, { &changed_sectors, sector_size });
+        writer.writeSectorPatches = false;
+        writer.appendBlob(&tiles_section.full, &tiles_copy, FileBlobCompressionScheme::LZ, {}, { &changed_sectors, sector_size });
+        writer.endSection(&tiles_section);
+
+        writer.startSection<TestSection_Empty>("EMPT"_id, 1);
+        TestSection_Empty empty = {};
+        empty.value = 42;
+        writer.endSection(&empty);
+
+        if (defer_compression) {
+            fill_memory<u8>(rows_copy.raw_data(), 0, rows_copy.size());
+            fill_memory<u8>(tiles_copy.items, 7, width * height);
+            writer.compressDeferredBlobs();
+        }
+
+        FileHandle file = openFile(path, FileAccessMode::Write);
+        bool succeeded = file.isOpen && writer.outputToFile(&file);
+        closeFile(&file);
+
+        return succeeded && writer.compressionStatistics.blobCount == 4;
+    };
+
+    auto read_file = [&](String path) {
+        bool succeeded = true;
+        FileHandle file = openFile(path, FileAccessMode::Read);
+        BinaryFileReader reader = readBinaryFile(&file, "TEST"_id, &arena);
+        succeeded &= reader.isValidFile;
+
+        // Read the sections in a different order to how they were written, so we know the TOC is right.
+        succeeded &= reader.startSection("EMPT"_id, 1);
+        TestSection_Empty* empty = reader.readStruct<TestSection_Empty>(0);
+        succeeded &= empty && empty->value == 42;
+        reader.endSection();
+
+        succeeded &= reader.startSection("TILE"_id, 1);
+        TestSection_Tiles* tiles_section = reader.readStruct<TestSection_Tiles>(0);
+        if (tiles_section) {
+            succeeded &= (tiles_section->patch.compressionScheme & FILE_BLOB_SECTOR_PATCH_FLAG) != 0;
+            auto loaded = arena.allocate_array_2d<u8>(width, height);
+            succeeded &= reader.readBlob(tiles_section->full, &loaded);
+            succeeded &= is_memory_equal(loaded.items, tiles.items, width * height);
+
+            auto patched = arena.allocate_array_2d<u8>(width, height);
+            succeeded &= reader.readBlob(tiles_section->patch, &patched);
+            succeeded &= patched.get(0, 0) == tiles.get(0, 0);
+            succeeded &= patched.get(width - 1, height - 1) == tiles.get(width - 1, height - 1);
+            succeeded &= patched.get(20, 20) == 0;
+        } else {
+            succeeded = false;
+        }
+        reader.endSection();
+
+        succeeded &= reader.startSection("MIXD"_id, 1);
+        TestSection_Mixed* mixed = reader.readStruct<TestSection_Mixed>(0);
+        if (mixed) {
+            succeeded &= reader.readString(mixed->name) == "Hello"_s;
+            succeeded &= (mixed->rows.compressionScheme & FILE_BLOB_FILTERED_FLAG) != 0;
+
+            Span<u8> loaded_rows = arena.allocate_multiple<u8>(rows.size());
+            succeeded &= reader.readBlob(mixed->rows, loaded_rows.raw_data(), loaded_rows.size());
+            succeeded &= is_memory_equal(loaded_rows.raw_data(), rows.raw_data(), rows.size());
+
+            Span<u8> loaded_noise = arena.allocate_multiple<u8>(noise.size());
+            succeeded &= reader.readBlob(mixed->noise, loaded_noise.raw_data(), loaded_noise.size());
+            succeeded &= is_memory_equal(loaded_noise.raw_data(), noise.raw_data(), noise.size());
+
+            auto loaded_numbers = reader.readArray<leU32>(mixed->numbers);
+            succeeded &= loaded_numbers.has_value() && loaded_numbers.value().size() == 10 && loaded_numbers.value()[9] == 81u;
+        } else {
+            succeeded = false;
+        }
+        reader.endSection();
+
+        closeFile(&file);
+        deleteFile(path);
+        return succeeded;
+    };
+
+    // Compressed as we go
+    {
+        String path = "TestBinaryFileWriter.tmp\0"_s;
+        EXPECT(write_file(path, false));
+        EXPECT(read_file(path));
+    }
+
+    // Compressed at the end, and moved into place
+    {
+        String path = "TestBinaryFileWriter-deferred.tmp\0"_s;
+        EXPECT(write_file(path, true));
+        EXPECT(read_file(path));
+    }
+}
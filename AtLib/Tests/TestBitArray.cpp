@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Harness/Harness.h"
+#include <Util/BitArray.h>
+#include <Util/MemoryArena.h>
+#include <Util/Random.h>
+#include <Util/String.h>
+
+// Checks every bit, the set bit count, and the range queries against a plain bool array.
+static bool matches(BitArray const& array, bool const* expected)
+{
+    s32 expected_count = 0;
+    for (s32 i = 0; i < array.size(); i++) {
+        if (array[i] != expected[i])
+            return false;
+        if (expected[i])
+            expected_count++;
+    }
+    if (array.set_bit_count() != expected_count)
+        return false;
+    if (array.count_set_bits_in_range(0, array.size()) != expected_count)
+        return false;
+
+    for (s32 start = 0; start <= array.size(); start++) {
+        s32 expected_next = -1;
+        for (s32 i = start; i < array.size(); i++) {
+            if (expected[i]) {
+                expected_next = i;
+                break;
+            }
+        }
+        if (array.find_next_set_bit(start) != expected_next)
+            return false;
+    }
+
+    return true;
+}
+
+void test_main()
+{
+    MemoryArena arena { "TestBitArray"_s };
+
+    // 200 bits is three whole u64s and a partial one.
+    s32 const size = 200;
+    bool expected[size] {};
+
+    // Ranges that start and end either side of the u64 boundaries.
+    {
+        BitArray array { arena, size };
+        EXPECT(array.is_all_unset());
+        EXPECT(matches(array, expected));
+
+        bool all_match = true;
+        s32 boundaries[] = { 0, 1, 63, 64, 65, 127, 128, 129, 191, 192, 199, 200 };
+        for (s32 start : boundaries) {
+            for (s32 end : boundaries) {
+                if (end < start)
+                    continue;
+
+                array.unset_all();
+                for (s32 i = 0; i < size; i++)
+                    expected[i] = false;
+
+                array.set_range(start, end - start);
+                for (s32 i = start; i < end; i++)
+                    expected[i] = true;
+                all_match &= matches(array, expected);
+                all_match &= array.count_set_bits_in_range(start, end - start) == end - start;
+
+                // Overlapping ranges shouldn't count bits twice.
+                array.set_range(start / 2, (end - start) / 2);
+                for (s32 i = start / 2; i < (start / 2) + ((end - start) / 2); i++)
+                    expected[i] = true;
+                all_match &= matches(array, expected);
+            }
+        }
+        EXPECT(all_match);
+    }
+
+    // Unsetting ranges, and counting parts of the array.
+    {
+        BitArray array { arena, size };
+        for (s32 i = 0; i < size; i++) {
+            expected[i] = (i % 3) == 0;
+            if (expected[i])
+                array.set_bit(i);
+        }
+        EXPECT(matches(array, expected));
+        EXPECT(array.count_set_bits_in_range(0, 0) == 0);
+        EXPECT(array.count_set_bits_in_range(0, 3) == 1);
+        EXPECT(array.count_set_bits_in_range(60, 10) == 4);  // 60, 63, 66, 69
+        EXPECT(array.count_set_bits_in_range(190, 10) == 3); // 192, 195, 198
+
+        array.unset_range(50, 100);
+        for (s32 i = 50; i < 150; i++)
+            expected[i] = false;
+        EXPECT(matches(array, expected));
+        EXPECT(array.count_set_bits_in_range(50, 100) == 0);
+        EXPECT(array.find_next_set_bit(50) == 150);
+
+        array.unset_range(0, size);
+        EXPECT(array.is_all_unset());
+        EXPECT(array.find_next_set_bit(0) == -1);
+    }
+
+    // set_all() also sets the unused bits past the end, which mustn't leak into counts or searches.
+    {
+        BitArray array { arena, size };
+        array.set_all();
+        for (s32 i = 0; i < size; i++)
+            expected[i] = true;
+        EXPECT(array.is_all_set());
+        EXPECT(matches(array, expected));
+
+        array.unset_range(190, 10);
+        for (s32 i = 190; i < size; i++)
+            expected[i] = false;
+        EXPECT(array.set_bit_count() == 190);
+        EXPECT(array.count_set_bits_in_range(150, 50) == 40);
+        EXPECT(array.find_next_set_bit(190) == -1);
+        EXPECT(array.find_next_set_bit(199) == -1);
+        EXPECT(array.find_next_set_bit(size) == -1);
+        EXPECT(matches(array, expected));
+
+        array.set_range(199, 1);
+        expected[199] = true;
+        EXPECT(array.find_next_set_bit(190) == 199);
+        EXPECT(array.set_bit_count() == 191);
+        EXPECT(matches(array, expected));
+    }
+
+    // Combining arrays. 1000 bits is enough for the AVX2 path to do most of it, with a partial u64 left over.
+    {
+        auto random = Random::create(12345);
+        bool all_match = true;
+        for (s32 combine_size : { 200, 1000 }) {
+            bool a_bits[1000] {};
+            bool b_bits[1000] {};
+            bool expected_bits[1000] {};
+            BitArray a { arena, combine_size };
+            BitArray b { arena, combine_size };
+            auto randomise = [&] {
+                a.unset_all();
+                b.unset_all();
+                for (s32 i = 0; i < combine_size; i++) {
+                    a_bits[i] = random->random_bool();
+                    b_bits[i] = random->random_bool();
+                    if (a_bits[i])
+                        a.set_bit(i);
+                    if (b_bits[i])
+                        b.set_bit(i);
+                }
+            };
+
+            randomise();
+            a.and_with(b);
+            for (s32 i = 0; i < combine_size; i++)
+                expected_bits[i] = a_bits[i] && b_bits[i];
+            all_match &= matches(a, expected_bits);
+
+            randomise();
+            a.or_with(b);
+            for (s32 i = 0; i < combine_size; i++)
+                expected_bits[i] = a_bits[i] || b_bits[i];
+            all_match &= matches(a, expected_bits);
+
+            randomise();
+            a.and_not_with(b);
+            for (s32 i = 0; i < combine_size; i++)
+                expected_bits[i] = a_bits[i] && !b_bits[i];
+            all_match &= matches(a, expected_bits);
+            all_match &= matches(b, b_bits);
+
+            // set_all() leaves the bits past the end set, and they mustn't be counted after combining.
+            randomise();
+            b.set_all();
+            a.or_with(b);
+            all_match &= a.is_all_set();
+            b.unset_all();
+            a.and_not_with(b);
+            all_match &= a.is_all_set();
+            a.and_with(b);
+            all_match &= a.is_all_unset();
+        }
+        EXPECT(all_match);
+    }
+
+    // An array that's an exact number of u64s, so there are no unused bits.
+    {
+        BitArray array { arena, 128 };
+        array.set_bit(127);
+        EXPECT(array.find_next_set_bit(0) == 127);
+        EXPECT(array.find_next_set_bit(127) == 127);
+        EXPECT(array.find_next_set_bit(128) == -1);
+        array.set_range(0, 128);
+        EXPECT(array.is_all_set());
+        EXPECT(array.count_set_bits_in_range(64, 64) == 64);
+        array.unset_range(64, 64);
+        EXPECT(array.set_bit_count() == 64);
+        EXPECT(array.find_next_set_bit(64) == -1);
+    }
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Harness/Harness.h"
+#include "Harness/TestData.h"
+#include <IO/BinaryFile.h>
+#include <Util/MemoryArena.h>
+#include <Util/String.h>
+
+// Filters the data, then undoes the filters, both into a separate buffer and in-place the way
+// BinaryFileReader does when nothing was packed. Also passes back the header, so the caller can
+// check which filters were actually applied.
+static bool round_trips(MemoryArena& arena, FileBlobFilters filters, Span<u8> data, FileBlobFilterHeader* header_out = nullptr, smm* filtered_length_out = nullptr)
+{
+    smm length = data.size();
+    u8* filtered = arena.allocate_multiple<u8>(length).raw_data();
+    smm filtered_length = -1;
+    FileBlobFilterHeader header = applyBlobFilters(filters, data.raw_data(), length, filtered, &filtered_length);
+    if (header_out)
+        *header_out = header;
+    if (filtered_length_out)
+        *filtered_length_out = filtered_length;
+
+    if (filtered_length != blobFilteredLength(header, length))
+        return false;
+
+    u8* scratch = arena.allocate_multiple<u8>(length).raw_data();
+    if (!decodes_to_original(arena, data, [&](u8* unfiltered) { undoBlobFilters(header, filtered, length, unfiltered, scratch); return true; }))
+        return false;
+
+    if (header.bitsPerValue == 8) {
+        undoBlobFilters(header, filtered, length, filtered, scratch);
+        if (!is_memory_equal(filtered, data.raw_data(), length))
+            return false;
+    }
+
+    return true;
+}
+
+void test_main()
+{
+    MemoryArena arena { "TestBlobFilters"_s };
+
+    auto random = Random::create(12345);
+
+    // No filters
+    {
+        Span<u8> data = make_random_bytes(arena, *random, 100);
+
+        FileBlobFilterHeader header;
+        smm filtered_length;
+        EXPECT(round_trips(arena, {}, data, &header, &filtered_length));
+        EXPECT(header.bitsPerValue == 8 && header.transposeStride == 1 && header.rowLength == 0);
+        EXPECT(filtered_length == 100);
+        EXPECT(round_trips(arena, { .packValues = true, .rowLength = 10, .transposeStride = 4 }, Span<u8> {}));
+    }
+
+    // Transpose, including a partial struct on the end, and data shorter than one struct
+    {
+        bool all_match = true;
+        for (s32 stride = 2; stride <= 16; stride++) {
+            for (s32 extra = 0; extra < stride; extra++) {
+                Span<u8> data = make_random_bytes(arena, *random, (50 * stride) + extra);
+
+                FileBlobFilterHeader header;
+                all_match &= round_trips(arena, { .transposeStride = (u8)stride }, data, &header);
+                all_match &= header.transposeStride == stride;
+            }
+        }
+        EXPECT(all_match);
+
+        // The first bytes of each struct end up together
+        u8 structs[] = { 1, 10, 100, 2, 20, 200, 3, 30, 44, 99 };
+        u8 filtered[sizeof(structs)];
+        smm filtered_length;
+        applyBlobFilters({ .transposeStride = 3 }, structs, sizeof(structs), filtered, &filtered_length);
+        u8 expected[] = { 1, 2, 3, 10, 20, 30, 100, 200, 44, 99 };
+        EXPECT(is_memory_equal(filtered, expected, sizeof(expected)));
+
+        Span<u8> short_data = make_bytes(arena, 5, [](smm i) { return i; });
+        FileBlobFilterHeader header;
+        EXPECT(round_trips(arena, { .transposeStride = 8 }, short_data, &header));
+        EXPECT(header.transposeStride == 1);
+    }
+
+    // Row delta, including a partial row on the end, and data shorter than one row
+    {
+        bool all_match = true;
+        for (s32 extra = 0; extra < 64; extra += 7) {
+            Span<u8> data = make_bytes(arena, (64 * 40) + extra, [](smm i) { return ((i % 64) + (i / 64)) * 3; }); // Wraps around past 255
+
+            FileBlobFilterHeader header;
+            all_match &= round_trips(arena, { .rowLength = 64 }, data, &header);
+            all_match &= header.rowLength == 64;
+        }
+        EXPECT(all_match);
+
+        Span<u8> short_data = make_bytes(arena, 64, [](smm i) { return i; });
+        FileBlobFilterHeader header;
+        EXPECT(round_trips(arena, { .rowLength = 64 }, short_data, &header));
+        EXPECT(header.rowLength == 0);
+    }
+
+    // Packing into 1, 2 and 4 bits, with lengths that don't fill the last byte
+    {
+        struct {
+            u8 largest_value;
+            u8 expected_bits;
+        } cases[] = { { 0, 1 }, { 1, 1 }, { 2, 2 }, { 3, 2 }, { 4, 4 }, { 15, 4 } };
+
+        bool all_match = true;
+        for (auto& it : cases) {
+            for (s32 length = 1; length <= 20; length++) {
+                Span<u8> data = make_random_bytes(arena, *random, length, it.largest_value + 1);
+                data[length / 2] = it.largest_value;
+
+                FileBlobFilterHeader header;
+                smm filtered_length;
+                all_match &= round_trips(arena, { .packValues = true }, data, &header, &filtered_length);
+                s32 values_per_byte = 8 / it.expected_bits;
+                all_match &= header.bitsPerValue == it.expected_bits;
+                all_match &= filtered_length == (length + values_per_byte - 1) / values_per_byte;
+            }
+        }
+        EXPECT(all_match);
+    }
+
+    // Values too big to pack are left alone
+    {
+        Span<u8> data = make_bytes(arena, 100, [](smm i) { return i % 4; });
+        data[73] = 16;
+
+        FileBlobFilterHeader header;
+        smm filtered_length;
+        EXPECT(round_trips(arena, { .packValues = true }, data, &header, &filtered_length));
+        EXPECT(header.bitsPerValue == 8);
+        EXPECT(filtered_length == 100);
+    }
+
+    // All three together, like an array of structs that's laid out in rows
+    {
+        s32 const stride = 4;
+        s32 const row_length = 32 * stride;
+        s32 const struct_bytes = row_length * 20;
+        Span<u8> data = make_bytes(arena, struct_bytes + 3, [&](smm i) { return (i < struct_bytes) ? (i % stride) : 3; });
+
+        FileBlobFilterHeader header;
+        smm filtered_length;
+        EXPECT(round_trips(arena, { .packValues = true, .rowLength = row_length, .transposeStride = stride }, data, &header, &filtered_length));
+        EXPECT(header.transposeStride == stride);
+        EXPECT(header.rowLength == row_length);
+        // Once transposed, each row only differs from the one above where one field's bytes end
+        // and the next one's begin.
+        EXPECT(header.bitsPerValue == 1);
+        EXPECT(filtered_length == (data.size() + 7) / 8);
+
+        // Random values, so the row deltas are too big to pack
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = random->random_integer<u8>();
+        EXPECT(round_trips(arena, { .packValues = true, .rowLength = row_length, .transposeStride = stride }, data, &header, &filtered_length));
+        EXPECT(header.transposeStride == stride);
+        EXPECT(header.rowLength == row_length);
+        EXPECT(header.bitsPerValue == 8);
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Harness/Harness.h"
+#include <Util/ChunkedArray.h>
+#include <Util/MemoryArena.h>
+#include <Util/String.h>
+
+// How lookups worked before ChunkedArray had a chunk directory, to check the directory against.
+template<typename T>
+static T& get_by_walking_chunks(ChunkedArray<T>& array, s32 index)
+{
+    s32 chunk_index = index / array.itemsPerChunk;
+    ArrayChunk<T>* chunk = array.firstChunk;
+    while (chunk_index > 0) {
+        chunk_index--;
+        chunk = chunk->nextChunk;
+    }
+    return chunk->items[index % array.itemsPerChunk];
+}
+
+void test_main()
+{
+    MemoryArena arena { "TestChunkedArray"_s };
+
+    // Indexing, with the arena
+    {
+        ChunkedArray<s32> array { arena, 4 };
+        for (s32 i = 0; i < 100; i++)
+            array.append(i);
+        EXPECT(array.count == 100);
+        EXPECT(array.chunkCount == 25);
+
+        bool all_match = true;
+        for (s32 i = 0; i < 100; i++)
+            all_match &= (array[i] == i) && (&array[i] == &get_by_walking_chunks(array, i));
+        EXPECT(all_match);
+        EXPECT(array.getChunkByIndex(12)->items == &get_by_walking_chunks(array, 48));
+    }
+
+    // Indexing, with a pool, as chunks are returned and reused
+    {
+        ArrayChunkPool<s32> pool { arena, 4 };
+        ChunkedArray<s32> a { pool };
+        ChunkedArray<s32> b { pool };
+
+        for (s32 i = 0; i < 50; i++) {
+            a.append(i);
+            b.append(1000 + i);
+        }
+        for (s32 i = 0; i < 30; i++)
+            (void)a.take_index(a.count - 1);
+        EXPECT(a.count == 20);
+        EXPECT(a.chunkCount == 5);
+
+        for (s32 i = 0; i < 30; i++)
+            b.append(1050 + i);
+        EXPECT(b.count == 80);
+
+        bool a_matches = true;
+        for (s32 i = 0; i < a.count; i++)
+            a_matches &= (a[i] == i);
+        EXPECT(a_matches);
+
+        bool b_matches = true;
+        for (s32 i = 0; i < b.count; i++)
+            b_matches &= (b[i] == 1000 + i) && (&b[i] == &get_by_walking_chunks(b, i));
+        EXPECT(b_matches);
+
+        a.clear();
+        EXPECT(a.chunkCount == 0);
+        for (s32 i = 0; i < 10; i++)
+            a.append(-i);
+        EXPECT(a[9] == -9);
+    }
+}
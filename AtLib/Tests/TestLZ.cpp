@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Harness/Harness.h"
+#include "Harness/TestData.h"
+#include <IO/BinaryFile.h>
+#include <IO/BinaryFileWriter.h>
+#include <Util/MemoryArena.h>
+#include <Util/String.h>
+
+// Encodes the data, checks it fits in lzMaxEncodedSize(), and that it decodes back to the original.
+static bool round_trips(MemoryArena& arena, Span<u8> data, smm* encoded_size_out = nullptr)
+{
+    smm size = data.size();
+    smm max_encoded_size = lzMaxEncodedSize(size);
+
+    u8* encoded = arena.allocate_multiple<u8>(max_encoded_size).raw_data();
+    smm encoded_size = lzEncode(data.raw_data(), size, encoded, max_encoded_size);
+    if (encoded_size < 0 || encoded_size > max_encoded_size)
+        return false;
+    if (encoded_size_out)
+        *encoded_size_out = encoded_size;
+
+    return decodes_to_original(arena, data, [&](u8* decoded) { return lzDecode(encoded, encoded_size, decoded, size); });
+}
+
+static bool decodes_to(BinaryFileWriter::CompressedBlob const& compressed, MemoryArena& arena, Span<u8> data)
+{
+    smm size = data.size();
+    switch (compressed.scheme) {
+    case FileBlobCompressionScheme::Uncompressed:
+        return compressed.length == size && is_memory_equal(compressed.data, data.raw_data(), size);
+    case FileBlobCompressionScheme::RLE_S8:
+        return decodes_to_original(arena, data, [&](u8* decoded) { return rleDecode(compressed.data, compressed.length, decoded, size); });
+    case FileBlobCompressionScheme::LZ:
+        return decodes_to_original(arena, data, [&](u8* decoded) { return lzDecode(compressed.data, compressed.length, decoded, size); });
+    default:
+        return false;
+    }
+}
+
+void test_main()
+{
+    MemoryArena arena { "TestLZ"_s };
+
+    auto random = Random::create(12345);
+
+    // Empty, and too short to contain a match
+    {
+        EXPECT(round_trips(arena, Span<u8> {}));
+
+        bool all_match = true;
+        for (s32 size = 1; size <= 20; size++)
+            all_match &= round_trips(arena, make_bytes(arena, size, [](smm i) { return i % 3; }));
+        EXPECT(all_match);
+    }
+
+    // Noise doesn't compress, but must still fit in lzMaxEncodedSize(), even with extended literal counts.
+    {
+        EXPECT(round_trips(arena, make_random_bytes(arena, *random, 10000)));
+    }
+
+    // A long run is a short literal and then one long match that overlaps its own output.
+    {
+        smm encoded_size = 0;
+        EXPECT(round_trips(arena, make_bytes(arena, 100000, [](smm) { return 42; }), &encoded_size));
+        EXPECT(encoded_size < 500);
+    }
+
+    // Repeating patterns shorter than a match, so every match overlaps its output.
+    {
+        bool all_match = true;
+        for (s32 period = 1; period <= 9; period++)
+            all_match &= round_trips(arena, make_bytes(arena, 1000 + period, [&](smm i) { return (i % period) * 17; }));
+        EXPECT(all_match);
+    }
+
+    // Noise and runs mixed together, with lengths either side of the extended count thresholds.
+    {
+        bool all_match = true;
+        for (s32 attempt = 0; attempt < 50; attempt++) {
+            Span<u8> data = arena.allocate_multiple<u8>(random->random_between(5000, 6000));
+            s32 pos = 0;
+            while (pos < data.size()) {
+                s32 length = min<s32>(random->random_between(1, 301), data.size() - pos);
+                bool is_run = random->random_bool();
+                u8 value = random->random_integer<u8>();
+                for (s32 i = 0; i < length; i++)
+                    data[pos + i] = is_run ? value : random->random_integer<u8>();
+                pos += length;
+            }
+            all_match &= round_trips(arena, data);
+        }
+        EXPECT(all_match);
+    }
+
+    // An array of structs, where most fields repeat from one struct to the next.
+    {
+        struct Thing {
+            u32 id;
+            u16 type;
+            u8 flags;
+            u8 variant;
+            u32 timestamp;
+        };
+        s32 const count = 2000;
+        Span<u8> data = arena.allocate_multiple<u8>(count * sizeof(Thing));
+        for (s32 i = 0; i < count; i++) {
+            Thing thing { (u32)i, (u16)(i % 5), 1, (u8)random->random_below(4), 1000 };
+            copyMemory((u8 const*)&thing, data.raw_data() + (i * sizeof(Thing)), sizeof(Thing));
+        }
+        smm encoded_size = 0;
+        EXPECT(round_trips(arena, data, &encoded_size));
+        EXPECT(encoded_size < data.size());
+    }
+
+    // Not enough room to encode is reported, not written past.
+    {
+        u8 data[100];
+        for (auto& it : data)
+            it = random->random_integer<u8>();
+        u8 dest[101];
+        dest[50] = 0xAB;
+        EXPECT(lzEncode(data, sizeof(data), dest, 50) == -1);
+        EXPECT(dest[50] == 0xAB);
+    }
+
+    // Corrupt or truncated data is rejected, not read or written past the end of.
+    {
+        Span<u8> data = make_bytes(arena, 1000, [&](smm i) { return (i < 500) ? random->random_integer<u8>() : 7; });
+
+        smm max_encoded_size = lzMaxEncodedSize(data.size());
+        u8* encoded = arena.allocate_multiple<u8>(max_encoded_size).raw_data();
+        smm encoded_size = lzEncode(data.raw_data(), data.size(), encoded, max_encoded_size);
+        u8* decoded = arena.allocate_multiple<u8>(data.size() + 1).raw_data();
+        EXPECT(lzDecode(encoded, encoded_size, decoded, data.size()));
+
+        bool all_truncations_fail = true;
+        for (smm length = 0; length < encoded_size; length++)
+            all_truncations_fail &= !lzDecode(encoded, length, decoded, data.size());
+        EXPECT(all_truncations_fail);
+
+        EXPECT(!lzDecode(encoded, encoded_size, decoded, data.size() - 1));
+        EXPECT(!lzDecode(encoded, encoded_size, decoded, data.size() + 1));
+
+        // A 4-byte literal, then a match with offset 0 or one reaching back before the start.
+        u8 zero_offset[] = { 0x40, 1, 2, 3, 4, 0, 0 };
+        EXPECT(!lzDecode(zero_offset, sizeof(zero_offset), decoded, 8));
+        u8 offset_too_far[] = { 0x40, 1, 2, 3, 4, 5, 0 };
+        EXPECT(!lzDecode(offset_too_far, sizeof(offset_too_far), decoded, 8));
+        u8 valid[] = { 0x40, 1, 2, 3, 4, 4, 0 };
+        EXPECT(lzDecode(valid, sizeof(valid), decoded, 8));
+
+        // A literal count that claims more bytes than there are.
+        u8 literal_too_long[] = { 0xF0, 255, 255 };
+        EXPECT(!lzDecode(literal_too_long, sizeof(literal_too_long), decoded, 1000));
+    }
+
+    // FileBlobCompressionScheme::Smallest picks whichever scheme does best, or none at all.
+    {
+        BinaryFileWriter writer = startWritingFile("TEST"_id, 1, &arena);
+
+        // One long run: RLE needs a couple of bytes per 127, LZ needs more to start up.
+        Span<u8> run = make_bytes(arena, 100, [](smm) { return 3; });
+        auto compressed_run = writer.compressBlob(FileBlobCompressionScheme::Smallest, run.size(), run.raw_data(), writer.blobScratch.compressed);
+        EXPECT(compressed_run.scheme == FileBlobCompressionScheme::RLE_S8);
+        EXPECT(compressed_run.length == rleEncode(run.raw_data(), run.size(), arena.allocate_multiple<u8>(rleMaxEncodedSize(run.size())).raw_data(), rleMaxEncodedSize(run.size())));
+        EXPECT(decodes_to(compressed_run, arena, run));
+
+        // A repeating pattern with no runs in it: RLE can't do anything with it, but LZ can.
+        Span<u8> pattern = make_bytes(arena, 4000, [](smm i) { return (i % 11) * 3; });
+        auto compressed_pattern = writer.compressBlob(FileBlobCompressionScheme::Smallest, pattern.size(), pattern.raw_data(), writer.blobScratch.compressed);
+        EXPECT(compressed_pattern.scheme == FileBlobCompressionScheme::LZ);
+        EXPECT(compressed_pattern.length < 100);
+        EXPECT(decodes_to(compressed_pattern, arena, pattern));
+
+        // Noise: neither scheme makes it smaller, so it's stored as it is.
+        Span<u8> noise = make_random_bytes(arena, *random, 4000);
+        auto compressed_noise = writer.compressBlob(FileBlobCompressionScheme::Smallest, noise.size(), noise.raw_data(), writer.blobScratch.compressed);
+        EXPECT(compressed_noise.scheme == FileBlobCompressionScheme::Uncompressed);
+        EXPECT(compressed_noise.data == noise.raw_data());
+        EXPECT(decodes_to(compressed_noise, arena, noise));
+
+        // Nothing at all
+        auto compressed_empty = writer.compressBlob(FileBlobCompressionScheme::Smallest, 0, noise.raw_data(), writer.blobScratch.compressed);
+        EXPECT(compressed_empty.scheme == FileBlobCompressionScheme::Uncompressed);
+        EXPECT(compressed_empty.length == 0);
+    }
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Harness/Harness.h"
+#include "Harness/TestData.h"
+#include <IO/BinaryFile.h>
+#include <Util/MemoryArena.h>
+#include <Util/String.h>
+
+// How RLE worked before it used SIMD, one byte at a time, for comparison.
+static smm scalar_rle_encode(u8 const* source, smm source_size, u8* dest)
+{
+    smm const min_run_length = 4;
+    smm dest_pos = 0;
+    smm literal_start = 0;
+
+    auto output_literals = [&](smm literal_end) {
+        while (literal_start < literal_end) {
+            smm literal_count = min<smm>(literal_end - literal_start, s8Max);
+            dest[dest_pos++] = (u8)(s8)-literal_count;
+            copyMemory(source + literal_start, dest + dest_pos, literal_count);
+            dest_pos += literal_count;
+            literal_start += literal_count;
+        }
+    };
+
+    smm pos = 0;
+    while (pos < source_size) {
+        smm max_run_length = min<smm>(source_size - pos, s8Max);
+        smm run_length = 1;
+        while ((run_length < max_run_length) && (source[pos + run_length] == source[pos]))
+            run_length++;
+
+        if (run_length < min_run_length) {
+            pos += run_length;
+            continue;
+        }
+
+        output_literals(pos);
+        dest[dest_pos++] = (u8)run_length;
+        dest[dest_pos++] = source[pos];
+        pos += run_length;
+        literal_start = pos;
+    }
+    output_literals(source_size);
+
+    return dest_pos;
+}
+
+static void scalar_rle_decode(u8 const* source, u8* dest, smm dest_size)
+{
+    smm source_pos = 0;
+    smm dest_pos = 0;
+    while (dest_pos < dest_size) {
+        s8 length = (s8)source[source_pos++];
+        if (length < 0) {
+            for (s8 i = 0; i < -length; i++)
+                dest[dest_pos++] = source[source_pos++];
+        } else {
+            u8 value = source[source_pos++];
+            for (s8 i = 0; i < length; i++)
+                dest[dest_pos++] = value;
+        }
+    }
+}
+
+// Encodes with both implementations, checks they agree, and that both decoders get the original back.
+static bool round_trips(MemoryArena& arena, Span<u8> data)
+{
+    smm size = data.size();
+    smm max_encoded_size = rleMaxEncodedSize(size);
+
+    u8* encoded = arena.allocate_multiple<u8>(max_encoded_size).raw_data();
+    smm encoded_size = rleEncode(data.raw_data(), size, encoded, max_encoded_size);
+
+    u8* scalar_encoded = arena.allocate_multiple<u8>(max_encoded_size).raw_data();
+    smm scalar_encoded_size = scalar_rle_encode(data.raw_data(), size, scalar_encoded);
+
+    if (encoded_size != scalar_encoded_size || !is_memory_equal(encoded, scalar_encoded, encoded_size))
+        return false;
+
+    return decodes_to_original(arena, data, [&](u8* decoded) { return rleDecode(encoded, encoded_size, decoded, size); })
+        && decodes_to_original(arena, data, [&](u8* decoded) { scalar_rle_decode(encoded, decoded, size); return true; });
+}
+
+void test_main()
+{
+    MemoryArena arena { "TestRLE"_s };
+
+    auto random = Random::create(12345);
+
+    // Empty, and sizes around the SIMD block sizes, all literals and all one run.
+    {
+        EXPECT(round_trips(arena, Span<u8> {}));
+
+        bool all_literals_match = true;
+        bool all_runs_match = true;
+        for (s32 size = 1; size <= 300; size++) {
+            all_literals_match &= round_trips(arena, make_bytes(arena, size, [](smm i) { return i; }));
+            all_runs_match &= round_trips(arena, make_bytes(arena, size, [](smm) { return 7; }));
+        }
+        EXPECT(all_literals_match);
+        EXPECT(all_runs_match);
+    }
+
+    // Runs of every length either side of the minimum, starting at every offset in a block, among noise.
+    {
+        bool all_match = true;
+        for (s32 run_length = 1; run_length <= 40; run_length++) {
+            for (s32 offset = 0; offset < 40; offset++) {
+                Span<u8> data = make_random_bytes(arena, *random, 100, 4);
+                for (s32 i = 0; i < run_length; i++)
+                    data[offset + i] = 9;
+                all_match &= round_trips(arena, data);
+            }
+        }
+        EXPECT(all_match);
+    }
+
+    // Random data with runs of random lengths, like a tile map.
+    {
+        bool all_match = true;
+        for (s32 attempt = 0; attempt < 50; attempt++) {
+            Span<u8> data = arena.allocate_multiple<u8>(random->random_between(5000, 6000));
+            s32 pos = 0;
+            while (pos < data.size()) {
+                s32 run_length = min<s32>(random->random_between(1, 301), data.size() - pos);
+                u8 value = (u8)random->random_below(3);
+                for (s32 i = 0; i < run_length; i++)
+                    data[pos + i] = value;
+                pos += run_length;
+            }
+            all_match &= round_trips(arena, data);
+        }
+        EXPECT(all_match);
+    }
+
+    // Corrupt or truncated data is rejected, not read past the end of.
+    {
+        u8 source[] = { 10, 1, (u8)-3, 2, 3, 4 };
+        u8 dest[13];
+        EXPECT(rleDecode(source, sizeof(source), dest, 13));
+        EXPECT(!rleDecode(source, sizeof(source) - 1, dest, 13));
+        EXPECT(!rleDecode(source, sizeof(source), dest, 12));
+        EXPECT(!rleDecode(source, sizeof(source), dest, 14));
+
+        u8 empty_run[] = { 0, 1 };
+        EXPECT(!rleDecode(empty_run, sizeof(empty_run), dest, 1));
+    }
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Harness/Harness.h"
+#include <IO/BinaryFileReader.h>
+#include <IO/BinaryFileWriter.h>
+#include <Util/Maths.h>
+#include <Util/MemoryArena.h>
+#include <Util/Random.h>
+#include <Util/String.h>
+
+struct TestSection {
+    FileBlob base;
+    FileBlob patches[2];
+    FileBlob emptyPatch;
+    FileBlob fullPatch;
+    FileBlob corruptPatches[6];
+};
+
+// Appends a hand-made sector patch, so that we can check the reader copes with nonsense.
+static void append_raw_patch(FileBlob* destination, BinaryFileWriter& writer, FileSectorPatchHeader header, Span<u32> sectorIndices, s32 tileCount, s32 truncateBy = 0)
+{
+    u8 bytes[1024] {};
+    u8* pos = bytes;
+    copyMemory(&header, (FileSectorPatchHeader*)pos, 1);
+    pos += sizeof(FileSectorPatchHeader);
+    for (u32 sectorIndex : sectorIndices) {
+        leU32 index = sectorIndex;
+        copyMemory(&index, (leU32*)pos, 1);
+        pos += sizeof(leU32);
+    }
+    pos += tileCount;
+
+    writer.appendBlob(destination, (s32)(pos - bytes) - truncateBy, bytes, FileBlobCompressionScheme::Uncompressed);
+    destination->compressionScheme = destination->compressionScheme | FILE_BLOB_SECTOR_PATCH_FLAG;
+}
+
+void test_main()
+{
+    MemoryArena arena { "TestSectorPatch"_s };
+    MemoryArena reader_arena { "TestSectorPatch reader"_s };
+
+    auto random = Random::create(12345);
+
+    // Neither dimension is a multiple of the sector size, so the right and bottom sectors are cut short.
+    s32 const width = 100;
+    s32 const height = 70;
+    s32 const sector_size = 16;
+    s32 const sectors_wide = divideCeil(width, sector_size);
+    s32 const sectors_high = divideCeil(height, sector_size);
+
+    auto make_copy = [&](Array2<u8> const& source) {
+        auto result = arena.allocate_array_2d<u8>(width, height);
+        copyMemory(source.items, result.items, width * height);
+        return result;
+    };
+    auto is_equal = [&](Array2<u8> const& a, Array2<u8> const& b) {
+        return is_memory_equal(a.items, b.items, width * height);
+    };
+
+    auto base = arena.allocate_array_2d<u8>(width, height);
+    for (s32 i = 0; i < width * height; i++)
+        base.items[i] = (u8)random->random_below(4);
+
+    // Each patch changes a few tiles, and records which sectors they're in.
+    Array2<u8> expected[2] = { make_copy(base), {} };
+    BitArray changed[2] = { { arena, sectors_wide * sectors_high }, { arena, sectors_wide * sectors_high } };
+    auto change_tile = [&](s32 patch, s32 x, s32 y) {
+        expected[patch].set(x, y, (u8)(200 + patch));
+        changed[patch].set_bit(((y / sector_size) * sectors_wide) + (x / sector_size));
+    };
+    change_tile(0, 5, 5);   // Top-left
+    change_tile(0, 99, 3);  // Right edge
+    change_tile(0, 40, 69); // Bottom edge
+    change_tile(0, 99, 69); // Bottom-right corner
+    change_tile(0, 0, 68);  // Bottom-left corner
+    expected[1] = make_copy(expected[0]);
+    change_tile(1, 99, 69); // Changed again
+    change_tile(1, 50, 30); // Only changed in the second patch
+
+    BitArray no_sectors { arena, sectors_wide * sectors_high };
+    BitArray all_sectors { arena, sectors_wide * sectors_high };
+    all_sectors.set_all();
+
+    String path = "TestSectorPatch.tmp\0"_s;
+
+    // Write everything
+    {
+        BinaryFileWriter writer = startWritingFile("TEST"_id, 1, &arena);
+        writer.addTOCEntry("TEST"_id);
+        writer.startSection<TestSection>("TEST"_id, 1);
+        TestSection section {};
+
+        // Without writeSectorPatches, the changed sectors are ignored and it's all written.
+        writer.appendBlob(&section.base, &base, FileBlobCompressionScheme::Smallest, {}, { &changed[0], sector_size });
+        EXPECT(!(section.base.compressionScheme & FILE_BLOB_SECTOR_PATCH_FLAG));
+
+        writer.writeSectorPatches = true;
+        for (s32 patch = 0; patch < 2; patch++)
+            writer.appendBlob(&section.patches[patch], &expected[patch], FileBlobCompressionScheme::Smallest, { .packValues = true }, { &changed[patch], sector_size });
+        EXPECT(section.patches[0].compressionScheme & FILE_BLOB_SECTOR_PATCH_FLAG);
+        EXPECT(section.patches[0].length < section.base.length);
+        writer.appendBlob(&section.emptyPatch, &base, FileBlobCompressionScheme::RLE_S8, {}, { &no_sectors, sector_size });
+        writer.appendBlob(&section.fullPatch, &expected[1], FileBlobCompressionScheme::LZ, {}, { &all_sectors, sector_size });
+
+        FileSectorPatchHeader header {};
+        header.arrayWidth = width;
+        header.arrayHeight = height;
+        header.sectorSize = sector_size;
+        header.sectorCount = 1;
+        u32 valid_sector[] = { 0 };
+        u32 corner_sector[] = { (u32)((sectors_wide * sectors_high) - 1) };
+        u32 outside_sector[] = { (u32)(sectors_wide * sectors_high) };
+
+        FileSectorPatchHeader zero_sector_size = header;
+        zero_sector_size.sectorSize = 0;
+        FileSectorPatchHeader too_many_sectors = header;
+        too_many_sectors.sectorCount = (sectors_wide * sectors_high) + 1;
+        FileSectorPatchHeader missing_sector_list = header;
+        missing_sector_list.sectorCount = 100;
+        s32 corner_tile_count = (width % sector_size) * (height % sector_size);
+
+        append_raw_patch(&section.corruptPatches[0], writer, header, {}, 0, 4);
+        append_raw_patch(&section.corruptPatches[1], writer, zero_sector_size, { 1, valid_sector }, sector_size * sector_size);
+        append_raw_patch(&section.corruptPatches[2], writer, too_many_sectors, { 1, valid_sector }, sector_size * sector_size);
+        append_raw_patch(&section.corruptPatches[3], writer, missing_sector_list, { 1, valid_sector }, 0);
+        append_raw_patch(&section.corruptPatches[4], writer, header, { 1, outside_sector }, sector_size * sector_size);
+        append_raw_patch(&section.corruptPatches[5], writer, header, { 1, corner_sector }, corner_tile_count, 1);
+
+        writer.endSection(&section);
+
+        FileHandle file = openFile(path, FileAccessMode::Write);
+        EXPECT(file.isOpen);
+        EXPECT(writer.outputToFile(&file));
+        closeFile(&file);
+    }
+
+    FileHandle file = openFile(path, FileAccessMode::Read);
+    BinaryFileReader reader = readBinaryFile(&file, "TEST"_id, &reader_arena);
+    EXPECT(reader.isValidFile);
+    EXPECT(reader.startSection("TEST"_id, 1));
+    TestSection* section = reader.readStruct<TestSection>(0);
+    EXPECT(section != nullptr);
+
+    // Loading the base, then each patch in turn, gets us the latest version.
+    {
+        auto loaded = arena.allocate_array_2d<u8>(width, height);
+        EXPECT(reader.readBlob(section->base, &loaded));
+        EXPECT(is_equal(loaded, base));
+        EXPECT(reader.readBlob(section->patches[0], &loaded));
+        EXPECT(is_equal(loaded, expected[0]));
+        EXPECT(reader.readBlob(section->patches[1], &loaded));
+        EXPECT(is_equal(loaded, expected[1]));
+    }
+
+    // A patch only touches its own sectors, so applying the second patch straight onto the base
+    // leaves out what the first one changed elsewhere.
+    {
+        auto loaded = make_copy(base);
+        EXPECT(reader.readBlob(section->patches[1], &loaded));
+        EXPECT(loaded.get(50, 30) == expected[1].get(50, 30));
+        EXPECT(loaded.get(99, 69) == expected[1].get(99, 69));
+        EXPECT(loaded.get(5, 5) == base.get(5, 5));
+        EXPECT(loaded.get(40, 69) == base.get(40, 69));
+    }
+
+    // Patches with no sectors, or all of them
+    {
+        auto loaded = make_copy(expected[0]);
+        EXPECT(reader.readBlob(section->emptyPatch, &loaded));
+        EXPECT(is_equal(loaded, expected[0]));
+
+        auto full = make_copy(base);
+        EXPECT(reader.readBlob(section->fullPatch, &full));
+        EXPECT(is_equal(full, expected[1]));
+    }
+
+    // Patches can only be applied to a 2D array of the size they were made from.
+    {
+        auto wrong_size = arena.allocate_array_2d<u8>(width - 1, height);
+        EXPECT(!reader.readBlob(section->patches[0], &wrong_size));
+
+        auto flat = arena.allocate_multiple<u8>(width * height);
+        EXPECT(!reader.readBlob(section->patches[0], flat.raw_data(), flat.size()));
+    }
+
+    // Corrupt patches are rejected, not read or written past the end of.
+    {
+        auto loaded = make_copy(base);
+        bool all_rejected = true;
+        for (auto const& corrupt_patch : section->corruptPatches)
+            all_rejected &= !reader.readBlob(corrupt_patch, &loaded);
+        EXPECT(all_rejected);
+    }
+
+    closeFile(&file);
+    deleteFile(path);
+}
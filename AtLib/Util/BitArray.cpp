@@ -6,8 +6,13 @@
 
 #include "BitArray.h"
 #include <Util/Assert.h>
+#include <Util/Maths.h>
 #include <Util/MemoryArena.h>
 
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#endif
+
 BitArray::BitArray(MemoryArena& arena, s32 size)
     : m_size(size)
     , m_data(arena.allocate_filled_array<u64>(calculate_u64_count(size)))
@@ -44,6 +49,23 @@ bool BitArray::operator[](u32 index) const
     return result;
 }
 
+u64 BitArray::get_bits(s32 start_index, s32 count) const
+{
+    ASSERT(count > 0 && count <= 64);
+    ASSERT(start_index >= 0 && (start_index + count) <= m_size);
+
+    u32 fieldIndex = start_index >> 6;
+    u32 bitIndex = start_index & 63;
+
+    u64 result = m_data[fieldIndex] >> bitIndex;
+
+    // The range may straddle two u64s
+    if (bitIndex != 0 && (bitIndex + count) > 64)
+        result |= m_data[fieldIndex + 1] << (64 - bitIndex);
+
+    return result & low_bits_mask(count);
+}
+
 void BitArray::set_bit(s32 index)
 {
     // NB: Check and assert done this way so that in debug builds, we assert, but
@@ -104,6 +126,144 @@ void BitArray::unset_all()
     }
 }
 
+void BitArray::set_range(s32 start_index, s32 count)
+{
+    update_range(start_index, count, true);
+}
+
+void BitArray::unset_range(s32 start_index, s32 count)
+{
+    update_range(start_index, count, false);
+}
+
+void BitArray::update_range(s32 start_index, s32 count, bool set)
+{
+    ASSERT(count >= 0);
+    ASSERT(start_index >= 0 && (start_index + count) <= m_size);
+
+    s32 end_index = start_index + count;
+    for (s32 index = start_index; index < end_index;) {
+        u32 fieldIndex = index >> 6;
+        u32 bitIndex = index & 63;
+        s32 bitsInField = min(64 - static_cast<s32>(bitIndex), end_index - index);
+        u64 mask = low_bits_mask(bitsInField) << bitIndex;
+
+        u64 before = m_data[fieldIndex];
+        u64 after = set ? (before | mask) : (before & ~mask);
+        m_data[fieldIndex] = after;
+        m_set_bit_count += count_set_bits(after) - count_set_bits(before);
+
+        index += bitsInField;
+    }
+}
+
+enum class CombineOperation : u8 {
+    And,
+    Or,
+    AndNot,
+};
+
+template<CombineOperation operation>
+static void combine_fields(u64* fields, u64 const* other_fields, s32 field_count)
+{
+    s32 fieldIndex = 0;
+
+#if defined(__AVX2__)
+    for (; fieldIndex + 4 <= field_count; fieldIndex += 4) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(fields + fieldIndex));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(other_fields + fieldIndex));
+        __m256i result;
+        if constexpr (operation == CombineOperation::And)
+            result = _mm256_and_si256(a, b);
+        else if constexpr (operation == CombineOperation::Or)
+            result = _mm256_or_si256(a, b);
+        else
+            result = _mm256_andnot_si256(b, a); // NB: andnot inverts its first argument
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(fields + fieldIndex), result);
+    }
+#endif
+
+    for (; fieldIndex < field_count; fieldIndex++) {
+        if constexpr (operation == CombineOperation::And)
+            fields[fieldIndex] &= other_fields[fieldIndex];
+        else if constexpr (operation == CombineOperation::Or)
+            fields[fieldIndex] |= other_fields[fieldIndex];
+        else
+            fields[fieldIndex] &= ~other_fields[fieldIndex];
+    }
+}
+
+void BitArray::and_with(BitArray const& other)
+{
+    ASSERT(other.m_size == m_size);
+    combine_fields<CombineOperation::And>(m_data.span().raw_data(), other.m_data.span().raw_data(), calculate_u64_count(m_size));
+    recalculate_set_bit_count();
+}
+
+void BitArray::or_with(BitArray const& other)
+{
+    ASSERT(other.m_size == m_size);
+    combine_fields<CombineOperation::Or>(m_data.span().raw_data(), other.m_data.span().raw_data(), calculate_u64_count(m_size));
+    recalculate_set_bit_count();
+}
+
+void BitArray::and_not_with(BitArray const& other)
+{
+    ASSERT(other.m_size == m_size);
+    combine_fields<CombineOperation::AndNot>(m_data.span().raw_data(), other.m_data.span().raw_data(), calculate_u64_count(m_size));
+    recalculate_set_bit_count();
+}
+
+void BitArray::recalculate_set_bit_count()
+{
+    // NB: set_all() sets the unused bits past the end of the array too, so we can't just count everything.
+    m_set_bit_count = count_set_bits_in_range(0, m_size);
+}
+
+s32 BitArray::count_set_bits_in_range(s32 start_index, s32 count) const
+{
+    ASSERT(count >= 0);
+    ASSERT(start_index >= 0 && (start_index + count) <= m_size);
+
+    s32 result = 0;
+    s32 end_index = start_index + count;
+    for (s32 index = start_index; index < end_index;) {
+        u32 fieldIndex = index >> 6;
+        u32 bitIndex = index & 63;
+        s32 bitsInField = min(64 - static_cast<s32>(bitIndex), end_index - index);
+
+        result += count_set_bits(m_data[fieldIndex] & (low_bits_mask(bitsInField) << bitIndex));
+
+        index += bitsInField;
+    }
+
+    return result;
+}
+
+s32 BitArray::find_next_set_bit(s32 start_index) const
+{
+    ASSERT(start_index >= 0);
+    if (start_index >= m_size)
+        return -1;
+
+    s32 fieldCount = calculate_u64_count(m_size);
+    s32 fieldIndex = start_index >> 6;
+    u64 field = m_data[fieldIndex] & ~low_bits_mask(start_index & 63);
+
+    while (true) {
+        if (field != 0) {
+            // The unused bits past the end of the array may be set, so check we're still inside it.
+            s32 index = (fieldIndex * 64) + count_trailing_zeros(field);
+            return (index < m_size) ? index : -1;
+        }
+
+        fieldIndex++;
+        if (fieldIndex >= fieldCount)
+            return -1;
+        field = m_data[fieldIndex];
+    }
+}
+
 Array<s32> BitArray::get_set_bit_indices() const
 {
     Array<s32> result = temp_arena().allocate_array<s32>(m_set_bit_count);
@@ -127,18 +287,25 @@ s32 BitArray::get_first_unset_bit_index() const
 
 s32 BitArray::get_first_matching_bit_index(bool set) const
 {
-    s32 result = -1;
-
-    if (m_set_bit_count != m_size) {
-        for (s32 index = 0; index < m_size; index++) {
-            if ((*this)[index] == set) {
-                result = index;
-                break;
-            }
-        }
+    // Early out if there are no matching bits
+    if (m_set_bit_count == (set ? 0 : m_size))
+        return -1;
+
+    // Check a whole u64 at a time, inverting it if we're looking for an unset bit.
+    s32 fieldCount = calculate_u64_count(m_size);
+    for (s32 fieldIndex = 0; fieldIndex < fieldCount; fieldIndex++) {
+        u64 field = set ? m_data[fieldIndex] : ~m_data[fieldIndex];
+
+        // Ignore the unused bits past the end of the array
+        s32 bitsInField = m_size - (fieldIndex * 64);
+        if (bitsInField < 64)
+            field &= low_bits_mask(bitsInField);
+
+        if (field != 0)
+            return (fieldIndex * 64) + count_trailing_zeros(field);
     }
 
-    return result;
+    return -1;
 }
 
 BitArrayIterator BitArray::iterate_set_bits() const
@@ -162,17 +329,19 @@ BitArrayIterator::BitArrayIterator(BitArray const& array)
 
 void BitArrayIterator::next()
 {
-    while (!m_is_done) {
-        m_current_index++;
-
-        if (m_current_index >= m_array.size()) {
-            m_is_done = true;
-        } else {
-            // Only stop iterating if we find a set bit
-            if (get_value())
-                break;
-        }
+    if (m_is_done)
+        return;
+
+    // This looks at 64 bits at a time, so that iterating is proportional to the number of set bits
+    // rather than the size of the array, when the array is sparse.
+    s32 next_index = m_array.find_next_set_bit(m_current_index + 1);
+    if (next_index == -1) {
+        m_current_index = m_array.size();
+        m_is_done = true;
+        return;
     }
+
+    m_current_index = next_index;
 }
 
 bool BitArrayIterator::has_next() const
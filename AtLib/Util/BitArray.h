@@ -18,6 +18,9 @@ public:
 
     bool operator[](u32 index) const;
 
+    // Returns `count` (1 to 64) consecutive bits starting at start_index, packed into the low bits of the result.
+    u64 get_bits(s32 start_index, s32 count) const;
+
     // TODO: Could keep a record of the highest/lowest set/unset bit indices, rather than calculating them each time!
     // Wouldn't even be that hard, just a min() or max() when a bit changes.
 
@@ -33,6 +36,16 @@ public:
     void set_all();
     void unset_all();
 
+    // Set or unset the `count` consecutive bits starting at start_index, a u64 at a time.
+    void set_range(s32 start_index, s32 count);
+    void unset_range(s32 start_index, s32 count);
+
+    // Combine another array of the same size into this one, in place.
+    // These use AVX2 when it's available, so they're cheap even for large arrays.
+    void and_with(BitArray const&);
+    void or_with(BitArray const&);
+    void and_not_with(BitArray const&); // Unsets every bit that's set in the other array.
+
     s32 set_bit_count() const { return m_set_bit_count; }
     bool is_all_unset() const { return m_set_bit_count == 0; }
     bool is_all_set() const { return m_set_bit_count == m_size; }
@@ -42,6 +55,9 @@ public:
     s32 get_first_set_bit_index() const;
     s32 get_first_unset_bit_index() const;
     s32 get_first_matching_bit_index(bool set) const;
+    // Returns the index of the first set bit at or after start_index, or -1 if there isn't one.
+    s32 find_next_set_bit(s32 start_index) const;
+    s32 count_set_bits_in_range(s32 start_index, s32 count) const;
 
     // NB: This only handles iterating through set bits, because that's all we need right now,
     // and I'm not sure iterating through unset bits too is useful.
@@ -54,6 +70,9 @@ public:
 private:
     BitArray(s32 size, Array<u64>);
 
+    void update_range(s32 start_index, s32 count, bool set);
+    void recalculate_set_bit_count();
+
     s32 m_size { 0 };
     s32 m_set_bit_count { 0 };
     Array<u64> m_data {};
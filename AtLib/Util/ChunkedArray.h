@@ -11,12 +11,16 @@
 #include <Util/DeprecatedPool.h>
 #include <Util/Indexed.h>
 #include <Util/Log.h>
+#include <Util/Maths.h>
 #include <Util/MemoryArena.h>
 
 /**
  * Variation on Array where we allocate the data in chunks, which are linked-listed together.
  * This means we can allocate them within a memory arena, and have more control there.
  * BUT, it also means the array won't be contiguous after allocating a second chunk.
+ *
+ * We also keep a directory of pointers to the chunks, so that accessing an item by index
+ * is a divide and two loads, instead of walking the chunk list.
  */
 
 template<typename T>
@@ -71,6 +75,8 @@ struct ChunkedArray {
         , count(0)
         , firstChunk(nullptr)
         , lastChunk(nullptr)
+        , chunkDirectory(nullptr)
+        , chunkDirectoryCapacity(0)
     {
         appendChunk();
     }
@@ -83,6 +89,8 @@ struct ChunkedArray {
         , count(0)
         , firstChunk(nullptr)
         , lastChunk(nullptr)
+        , chunkDirectory(nullptr)
+        , chunkDirectoryCapacity(0)
     {
     }
 
@@ -96,6 +104,11 @@ struct ChunkedArray {
     ArrayChunk<T>* firstChunk;
     ArrayChunk<T>* lastChunk;
 
+    // chunkDirectory[i] is the i-th chunk. It only grows: chunks returned to the pool leave their slot behind,
+    // to be overwritten when we take another chunk.
+    ArrayChunk<T>** chunkDirectory;
+    s32 chunkDirectoryCapacity;
+
     bool is_empty() const { return count == 0; }
 
     T& operator[](size_t index)
@@ -105,22 +118,7 @@ struct ChunkedArray {
         auto chunk_index = index / itemsPerChunk;
         auto item_index = index % itemsPerChunk;
 
-        // Access first chunk directly
-        if (chunk_index == 0)
-            return firstChunk->items[item_index];
-
-        // Access last chunk directly
-        if (chunk_index == (chunkCount - 1))
-            return lastChunk->items[item_index];
-
-        // Walk the chunk chain
-        ArrayChunk<T>* chunk = firstChunk;
-        while (chunk_index > 0) {
-            chunk_index--;
-            chunk = chunk->nextChunk;
-        }
-
-        return chunk->items[item_index];
+        return chunkDirectory[chunk_index]->items[item_index];
     }
     T const& operator[](size_t index) const { return const_cast<ChunkedArray&>(*this)[index]; }
 
@@ -406,17 +404,7 @@ struct ChunkedArray {
         }
 
         // Shortcut to the last chunk, because that's what we want 99% of the time!
-        ArrayChunk<T>* chunk = nullptr;
-        if (useLastChunk) {
-            chunk = lastChunk;
-        } else {
-            chunk = firstChunk;
-            s32 indexWithinChunk = count;
-            while (indexWithinChunk >= itemsPerChunk) {
-                chunk = chunk->nextChunk;
-                indexWithinChunk -= itemsPerChunk;
-            }
-        }
+        ArrayChunk<T>* chunk = useLastChunk ? lastChunk : chunkDirectory[count / itemsPerChunk];
 
         count++;
 
@@ -438,6 +426,10 @@ struct ChunkedArray {
         newChunk->prevChunk = lastChunk;
         newChunk->nextChunk = nullptr;
 
+        if (chunkCount == chunkDirectoryCapacity)
+            growChunkDirectory();
+        chunkDirectory[chunkCount] = newChunk;
+
         chunkCount++;
         if (lastChunk != nullptr) {
             lastChunk->nextChunk = newChunk;
@@ -452,23 +444,23 @@ struct ChunkedArray {
     {
         ASSERT(chunkIndex >= 0 && chunkIndex < chunkCount); // chunkIndex is out of range!
 
-        ArrayChunk<T>* chunk = nullptr;
-
-        // Shortcuts for known values
-        if (chunkIndex == 0) {
-            chunk = firstChunk;
-        } else if (chunkIndex == (chunkCount - 1)) {
-            chunk = lastChunk;
-        } else {
-            // Walk the chunk chain
-            chunk = firstChunk;
-            while (chunkIndex > 0) {
-                chunkIndex--;
-                chunk = chunk->nextChunk;
-            }
-        }
+        return chunkDirectory[chunkIndex];
+    }
 
-        return chunk;
+    void growChunkDirectory()
+    {
+        // Allocate from wherever our chunks come from.
+        MemoryArena* arena = (chunkPool != nullptr) ? chunkPool->memoryArena : memoryArena;
+
+        // NB: The old directory stays allocated in the arena, but as we double each time, that's at most
+        // as much again as the final directory.
+        s32 newCapacity = max(chunkDirectoryCapacity * 2, 4);
+        auto newDirectory = arena->allocate_multiple<ArrayChunk<T>*>(newCapacity);
+        for (s32 i = 0; i < chunkCount; i++)
+            newDirectory[i] = chunkDirectory[i];
+
+        chunkDirectory = newDirectory.raw_data();
+        chunkDirectoryCapacity = newCapacity;
     }
     ArrayChunk<T>* getLastNonEmptyChunk()
     {
@@ -492,6 +484,7 @@ struct ChunkedArray {
         if (firstChunk == chunk)
             firstChunk = lastChunk;
         chunkCount--;
+        chunkDirectory[chunkCount] = nullptr;
 
         addItemToPool<ArrayChunk<T>>(chunkPool, chunk);
     }
@@ -614,6 +607,6 @@ struct ChunkedArrayIterator {
     }
 
     T& get() { return currentChunk->items[indexInChunk]; }
-    s32 getIndex() { return (chunkIndex * array->itemsPerChunk) + indexInChunk; }
+    s32 getIndex() const { return (chunkIndex * array->itemsPerChunk) + indexInChunk; }
     T getValue() { return currentChunk->items[indexInChunk]; }
 };
@@ -8,6 +8,7 @@
 
 #include <Util/Basic.h>
 #include <Util/Forward.h>
+#include <bit>
 
 float const PI32 = 3.14159265358979323846f;
 float const radToDeg = 180.0f / PI32;
@@ -35,6 +36,12 @@ s32 truncate32(s64 in);
 
 u8 clamp01AndMap_u8(float in);
 
+// Bit twiddling for code that tests 64 flags at a time.
+inline s32 count_trailing_zeros(u64 value) { return std::countr_zero(value); }
+inline s32 count_set_bits(u64 value) { return std::popcount(value); }
+// Returns a u64 with the lowest `count` bits set. (count must be 0 to 64.)
+constexpr u64 low_bits_mask(s32 count) { return (count >= 64) ? u64Max : (((u64)1 << count) - 1); }
+
 template<typename T>
 constexpr T clamp(T value, T min, T max)
 {
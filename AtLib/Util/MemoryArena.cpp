@@ -9,7 +9,9 @@
 #include <Util/Memory.h>
 #include <Util/MemoryArena.h>
 
-static MemoryArena s_temp_arena { "Temp"_s, 4_MB };
+// Each thread gets its own temp arena, so that worker threads can still format strings and log.
+// Only the main thread's one gets reset every frame. The others are freed when their thread exits.
+static thread_local MemoryArena s_temp_arena { "Temp"_s, 4_MB };
 
 MemoryArena::MemoryArena(String name, Optional<size_t> initial_size, size_t minimum_block_size)
     : m_name(name)
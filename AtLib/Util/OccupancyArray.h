@@ -9,6 +9,7 @@
 #include <Util/Basic.h>
 #include <Util/BitArray.h>
 #include <Util/Indexed.h>
+#include <Util/Maths.h>
 #include <Util/MemoryArena.h>
 
 template<typename T>
@@ -43,39 +44,22 @@ struct OccupancyArray {
     OccupancyArrayChunk<T>* firstChunk { nullptr };
     OccupancyArrayChunk<T>* lastChunk { nullptr };
 
-    s32 firstChunkWithSpaceIndex { -1 };
-    OccupancyArrayChunk<T>* firstChunkWithSpace { nullptr };
+    // chunkDirectory[i] is the i-th chunk, so we can go straight to a chunk by index.
+    OccupancyArrayChunk<T>** chunkDirectory { nullptr };
+    // One bit per chunk, set if that chunk has an empty slot. append() finds the first one with a ctz per 64 chunks.
+    u64* chunksWithSpace { nullptr };
+    s32 chunkDirectoryCapacity { 0 }; // Always a multiple of 64
 
     // Methods
     Indexed<T> append()
     {
-        if (firstChunkWithSpace == nullptr) {
-            // Append a new chunk
-            smm arraySize = sizeof(T) * itemsPerChunk;
-            size_t occupancyArrayCount = BitArray::calculate_u64_count(itemsPerChunk);
-            smm occupancyArraySize = occupancyArrayCount * sizeof(u64);
-
-            auto [new_chunk, items] = memoryArena->allocate_with_data<OccupancyArrayChunk<T>>(arraySize + occupancyArraySize);
-            new_chunk.items = reinterpret_cast<T*>(items.raw_data());
-            new_chunk.occupancy = BitArray::from_memory(itemsPerChunk, { occupancyArrayCount, reinterpret_cast<u64*>(items.raw_data() + arraySize), occupancyArrayCount });
-
-            chunkCount++;
-
-            // Attach the chunk to the end, but also make it the "firstChunkWithSpace"
-            if (firstChunk == nullptr)
-                firstChunk = &new_chunk;
-
-            if (lastChunk != nullptr) {
-                lastChunk->nextChunk = &new_chunk;
-                new_chunk.prevChunk = lastChunk;
-            }
-            lastChunk = &new_chunk;
-
-            firstChunkWithSpace = &new_chunk;
-            firstChunkWithSpaceIndex = chunkCount - 1;
+        s32 chunkIndex = findFirstChunkWithSpace();
+        if (chunkIndex == -1) {
+            appendChunk();
+            chunkIndex = chunkCount - 1;
         }
 
-        OccupancyArrayChunk<T>* chunk = firstChunkWithSpace;
+        OccupancyArrayChunk<T>* chunk = chunkDirectory[chunkIndex];
 
         // get_first_unset_bit_index() to find the free slot
         s32 indexInChunk = chunk->occupancy.get_first_unset_bit_index();
@@ -84,7 +68,7 @@ struct OccupancyArray {
         // mark that slot as occupied
         chunk->occupancy.set_bit(indexInChunk);
         Indexed<T> result {
-            indexInChunk + (firstChunkWithSpaceIndex * itemsPerChunk),
+            indexInChunk + (chunkIndex * itemsPerChunk),
             chunk->items[indexInChunk]
         };
 
@@ -95,30 +79,8 @@ struct OccupancyArray {
         // update counts
         count++;
 
-        if (chunk->occupancy.is_all_set()) {
-            // recalculate firstChunkWithSpace/Index
-            if (count == itemsPerChunk * chunkCount) {
-                // We're full! So just set the firstChunkWithSpace to null
-                firstChunkWithSpace = nullptr;
-                firstChunkWithSpaceIndex = -1;
-            } else {
-                // There's a chunk with space, we just have to find it
-                // Assuming that firstChunkWithSpace is the first chunk with space, we just need to walk forwards from it.
-                // (If that's not, we have bigger problems!)
-                OccupancyArrayChunk<T>* nextChunk = chunk->nextChunk;
-                s32 nextChunkIndex = firstChunkWithSpaceIndex + 1;
-                while (nextChunk->occupancy.is_all_set()) {
-                    // NB: We don't check for a null nextChunk. It should never be null - if it is, something is corrupted
-                    // and we want to crash here, and the dereference will do that so no need to assert!
-                    // - Sam, 21/08/2019
-                    nextChunk = nextChunk->nextChunk;
-                    nextChunkIndex++;
-                }
-
-                firstChunkWithSpace = nextChunk;
-                firstChunkWithSpaceIndex = nextChunkIndex;
-            }
-        }
+        if (chunk->occupancy.is_all_set())
+            chunksWithSpace[chunkIndex / 64] &= ~(1ull << (chunkIndex % 64));
 
         ASSERT(&result.value() == get(result.index()));
 
@@ -134,6 +96,13 @@ struct OccupancyArray {
         return result;
     }
 
+    // Makes sure there's room for `extraCount` more items, so that many appends won't need to allocate.
+    void reserve(s32 extraCount)
+    {
+        while ((chunkCount * itemsPerChunk) - count < extraCount)
+            appendChunk();
+    }
+
     T* get(s32 index)
     {
         ASSERT(index < chunkCount * itemsPerChunk);
@@ -168,11 +137,7 @@ struct OccupancyArray {
         // Decrease counts
         count--;
 
-        // Update firstChunkWithSpace/Index if the index is lower.
-        if (chunkIndex < firstChunkWithSpaceIndex) {
-            firstChunkWithSpaceIndex = chunkIndex;
-            firstChunkWithSpace = chunk;
-        }
+        chunksWithSpace[chunkIndex / 64] |= 1ull << (chunkIndex % 64);
     }
 
     OccupancyArrayIterator<T> iterate()
@@ -181,16 +146,15 @@ struct OccupancyArray {
 
         iterator.array = this;
         iterator.chunkIndex = 0;
-        iterator.indexInChunk = 0;
+        iterator.indexInChunk = -1;
         iterator.currentChunk = firstChunk;
 
         // If the table is empty, we can skip some work.
         iterator.isDone = (count == 0);
 
-        // If the first entry is unoccupied, we need to skip ahead
-        if (!iterator.isDone && (iterator.get() == nullptr)) {
+        // Move to the first occupied entry
+        if (!iterator.isDone)
             iterator.next();
-        }
 
         return iterator;
     }
@@ -204,25 +168,59 @@ struct OccupancyArray {
     {
         ASSERT(chunkIndex >= 0 && chunkIndex < chunkCount); // chunkIndex is out of range!
 
-        OccupancyArrayChunk<T>* chunk = nullptr;
-
-        // Shortcuts for known values
-        if (chunkIndex == 0) {
-            chunk = firstChunk;
-        } else if (chunkIndex == (chunkCount - 1)) {
-            chunk = lastChunk;
-        } else if (chunkIndex == firstChunkWithSpaceIndex) {
-            chunk = firstChunkWithSpace;
-        } else {
-            // Walk the chunk chain
-            chunk = firstChunk;
-            while (chunkIndex > 0) {
-                chunkIndex--;
-                chunk = chunk->nextChunk;
-            }
+        return chunkDirectory[chunkIndex];
+    }
+
+    // "private"
+    s32 findFirstChunkWithSpace() const
+    {
+        for (s32 wordIndex = 0; wordIndex < chunkDirectoryCapacity / 64; wordIndex++) {
+            if (chunksWithSpace[wordIndex] != 0)
+                return (wordIndex * 64) + count_trailing_zeros(chunksWithSpace[wordIndex]);
         }
 
-        return chunk;
+        return -1;
+    }
+
+    void appendChunk()
+    {
+        if (chunkCount == chunkDirectoryCapacity) {
+            // NB: The old arrays stay allocated in the arena, but as we double each time, that's at most
+            // as much again as the final ones.
+            s32 newCapacity = max(chunkDirectoryCapacity * 2, 64);
+            auto newDirectory = memoryArena->allocate_multiple<OccupancyArrayChunk<T>*>(newCapacity);
+            auto newChunksWithSpace = memoryArena->allocate_multiple<u64>(newCapacity / 64);
+            for (s32 i = 0; i < chunkCount; i++)
+                newDirectory[i] = chunkDirectory[i];
+            for (s32 i = 0; i < newCapacity / 64; i++)
+                newChunksWithSpace[i] = (i < chunkDirectoryCapacity / 64) ? chunksWithSpace[i] : 0;
+
+            chunkDirectory = newDirectory.raw_data();
+            chunksWithSpace = newChunksWithSpace.raw_data();
+            chunkDirectoryCapacity = newCapacity;
+        }
+
+        smm arraySize = sizeof(T) * itemsPerChunk;
+        size_t occupancyArrayCount = BitArray::calculate_u64_count(itemsPerChunk);
+        smm occupancyArraySize = occupancyArrayCount * sizeof(u64);
+
+        auto [new_chunk, items] = memoryArena->allocate_with_data<OccupancyArrayChunk<T>>(arraySize + occupancyArraySize);
+        new_chunk.items = reinterpret_cast<T*>(items.raw_data());
+        new_chunk.occupancy = BitArray::from_memory(itemsPerChunk, { occupancyArrayCount, reinterpret_cast<u64*>(items.raw_data() + arraySize), occupancyArrayCount });
+
+        // Attach the chunk to the end
+        if (firstChunk == nullptr)
+            firstChunk = &new_chunk;
+
+        if (lastChunk != nullptr) {
+            lastChunk->nextChunk = &new_chunk;
+            new_chunk.prevChunk = lastChunk;
+        }
+        lastChunk = &new_chunk;
+
+        chunkDirectory[chunkCount] = &new_chunk;
+        chunksWithSpace[chunkCount / 64] |= 1ull << (chunkCount % 64);
+        chunkCount++;
     }
 };
 
@@ -241,26 +239,32 @@ struct OccupancyArrayIterator {
 
     void next()
     {
-        while (!isDone) {
-            indexInChunk++;
-
-            if (indexInChunk >= array->itemsPerChunk) {
-                // Next chunk
-                chunkIndex++;
-                currentChunk = currentChunk->nextChunk;
-                indexInChunk = 0;
-
-                if (currentChunk == nullptr) {
-                    // We're not wrapping, so we're done
-                    isDone = true;
+        if (isDone)
+            return;
+
+        indexInChunk++;
+        while (currentChunk != nullptr) {
+            // Skip empty chunks entirely, and otherwise jump to the next occupied slot 64 at a time.
+            if (currentChunk->occupancy.set_bit_count() > 0) {
+                while (indexInChunk < array->itemsPerChunk) {
+                    s32 bitCount = min(array->itemsPerChunk - indexInChunk, 64);
+                    u64 occupiedBits = currentChunk->occupancy.get_bits(indexInChunk, bitCount);
+                    if (occupiedBits != 0) {
+                        indexInChunk += count_trailing_zeros(occupiedBits);
+                        return;
+                    }
+                    indexInChunk += bitCount;
                 }
             }
 
-            // Only stop iterating if we find an occupied entry
-            if (currentChunk != nullptr && get() != nullptr) {
-                break;
-            }
+            // Next chunk
+            chunkIndex++;
+            currentChunk = currentChunk->nextChunk;
+            indexInChunk = 0;
         }
+
+        // We're not wrapping, so we're done
+        isDone = true;
     }
 
     T* get()
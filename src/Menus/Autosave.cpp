@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "Autosave.h"
+#include <Debug/Debug.h>
+#include <IO/File.h>
+#include <Menus/SaveFile.h>
+#include <Menus/SavedGames.h>
+#include <SDL2/SDL_timer.h>
+#include <Sim/City.h>
+#include <UI/Toast.h>
+#include <Util/Log.h>
+#include <Util/Time.h>
+
+Autosave::~Autosave()
+{
+    // Don't abandon a half-written save. The worker only compresses and writes the one file, so this won't take long.
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+void Autosave::update(City& city, bool should_start)
+{
+    if (m_worker.joinable() && m_worker_finished.load(std::memory_order_acquire))
+        finish();
+
+    if (should_start && !m_worker.joinable())
+        start(city);
+}
+
+void Autosave::start(City& city)
+{
+    DEBUG_FUNCTION();
+
+    m_start_ticks = SDL_GetTicks();
+
+    // Everything the worker touches has to live in m_arena, because temp_arena() is reset each frame.
+    m_arena.reset();
+
+    if (m_chain_id == 0 || m_patch_count >= MAX_SAVE_PATCHES) {
+        // Start a new chain. The ID only has to differ from any old chain whose patches might still be around.
+        u64 chain_id = ((u64)get_current_unix_timestamp() << 32) ^ SDL_GetPerformanceCounter();
+        m_saving_patch = { .chainID = (chain_id != 0) ? chain_id : 1, .patchIndex = 0 };
+        m_path = m_arena.allocate_string(savedGamePath("autosave"_s));
+    } else {
+        m_saving_patch = { .chainID = m_chain_id, .patchIndex = (u32)m_patch_count + 1 };
+        m_path = m_arena.allocate_string(savedGamePatchPath("autosave"_s, m_saving_patch.patchIndex));
+    }
+
+    // The temporary file is hidden, so the saved games catalogue ignores it. It also needs to be in
+    // the same directory as the real save, so that the rename is atomic.
+    m_temp_path = m_arena.allocate_string(savedGamePath(".autosave-in-progress"_s));
+
+    // The snapshot. After this, the city is free to change, and the next patch only needs what changes from here.
+    m_writer = serialise_city(city, &m_arena, m_saving_patch);
+    city.clear_unsaved_sectors();
+
+    m_worker_finished.store(false, std::memory_order_relaxed);
+    m_worker = std::thread([this] {
+        // NB: Nothing in here may use the debug system, as it isn't thread-safe. Logging is fine, and so is
+        //     allocating from m_arena, as nothing else touches it until we're finished.
+        m_writer.compressDeferredBlobs();
+        m_writer.logCompressionStatistics();
+
+        // The file has to be on the disk before it replaces the previous save, or a crash could lose both.
+        FileHandle file = openFileForSyncedWrite(m_temp_path);
+        bool succeeded = file.isOpen && m_writer.outputToFile(&file);
+        succeeded = closeFileAndSync(&file) && succeeded;
+
+        if (succeeded)
+            succeeded = renameFile(m_temp_path, m_path);
+
+        m_worker_succeeded = succeeded;
+        m_worker_finished.store(true, std::memory_order_release);
+    });
+}
+
+void Autosave::finish()
+{
+    m_worker.join();
+
+    if (m_worker_succeeded) {
+        logInfo("Autosaved to '{0}' in {1} milliseconds."_s, { m_path, formatInt(SDL_GetTicks() - m_start_ticks) });
+
+        if (m_saving_patch.patchIndex == 0) {
+            // The old patches belong to the previous chain, so they'd be ignored anyway, but tidy them up.
+            for (s32 patch_index = 1; patch_index <= m_patch_count; patch_index++)
+                deleteFile(savedGamePatchPath("autosave"_s, patch_index));
+        }
+        m_chain_id = m_saving_patch.chainID;
+        m_patch_count = m_saving_patch.patchIndex;
+    } else {
+        logError("Autosave to '{0}' failed."_s, { m_path });
+        deleteFile(m_temp_path);
+        UI::Toast::show(getText("msg_save_failure"_s, { m_path }));
+
+        // The city's unsaved sectors were cleared when this one started, so a patch would miss those
+        // changes. Start over with a full save.
+        m_chain_id = 0;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <IO/BinaryFileWriter.h>
+#include <Menus/SaveFile.h>
+#include <Sim/Forward.h>
+#include <Util/Basic.h>
+#include <Util/MemoryArena.h>
+#include <Util/String.h>
+#include <atomic>
+#include <thread>
+
+// Saves the city in the background, without stalling the game.
+// Autosaving happens in two halves. First, between simulation ticks on the main thread, everything
+// that needs saving is copied into the autosave's arena: the tile arrays (or just their changed sectors,
+// for a patch), the building records, and the rest of each layer's state. That copy is our snapshot:
+// the simulation carries on changing the city, and the save doesn't notice. Then a worker thread
+// compresses it, writes it out to a temporary file, and renames that over the real one, so that a crash
+// part-way through never leaves a half-written save behind.
+// Most autosaves are patches, which only contain the parts of the map that changed since the one
+// before. Once there are MAX_SAVE_PATCHES of them, the next autosave is a full one, and the old
+// patches are deleted. See SAV_PATCH_ID.
+class Autosave {
+public:
+    Autosave() = default;
+    ~Autosave();
+
+    // Call once per frame, after the city has been updated.
+    // Starts a new autosave if `should_start` is set and there isn't one already running.
+    void update(City&, bool should_start);
+
+    bool is_in_progress() const { return m_worker.joinable(); }
+
+private:
+    void start(City&);
+    void finish();
+
+    MemoryArena m_arena { "Autosave"_s };
+    BinaryFileWriter m_writer {};
+    String m_path; // Where the in-progress save is going: the base file, or a patch
+    String m_temp_path;
+    SavePatchInfo m_saving_patch {};
+
+    // The chain that's on disk. A chain ID of 0 means there isn't one yet, so the next save has to be a base.
+    u64 m_chain_id { 0 };
+    s32 m_patch_count { 0 };
+    u32 m_start_ticks { 0 };
+
+    std::thread m_worker;
+    std::atomic<bool> m_worker_finished { false };
+    bool m_worker_succeeded { false }; // Only read after m_worker_finished is set
+};
@@ -8,69 +8,155 @@
 #include <Gfx/Renderer.h>
 #include <IO/BinaryFileReader.h>
 #include <IO/BinaryFileWriter.h>
+#include <Menus/SavedGames.h>
 #include <Sim/City.h>
 #include <Sim/Game.h>
 #include <Sim/Terrain.h>
 #include <Sim/Zone.h>
 
+BinaryFileWriter serialise_city(City const& city, MemoryArena* arena, Optional<SavePatchInfo> patch)
+{
+    DEBUG_FUNCTION();
+
+    BinaryFileWriter writer = startWritingFile(SAV_FILE_ID, SAV_VERSION, arena);
+    writer.writeSectorPatches = patch.has_value() && patch.value().patchIndex > 0;
+    // Compression is most of the cost, so leave it until the end, when it can happen in parallel, and
+    // without the city. The blobs only get copied until then.
+    writer.deferCompression = true;
+
+    // Prepare the TOC
+    writer.addTOCEntry(SAV_META_ID);
+    writer.addTOCEntry(SAV_BUILDING_ID);
+    writer.addTOCEntry(SAV_CRIME_ID);
+    writer.addTOCEntry(SAV_EDUCATION_ID);
+    writer.addTOCEntry(SAV_FIRE_ID);
+    writer.addTOCEntry(SAV_HEALTH_ID);
+    writer.addTOCEntry(SAV_LANDVALUE_ID);
+    writer.addTOCEntry(SAV_POLLUTION_ID);
+    writer.addTOCEntry(SAV_TERRAIN_ID);
+    writer.addTOCEntry(SAV_TRANSPORT_ID);
+    writer.addTOCEntry(SAV_ZONE_ID);
+    if (patch.has_value())
+        writer.addTOCEntry(SAV_PATCH_ID);
+
+    // Meta
+    {
+        writer.startSection<SAVSection_Meta>(SAV_META_ID, SAV_META_VERSION);
+        SAVSection_Meta metaSection = {};
+
+        metaSection.saveTimestamp = get_current_unix_timestamp();
+        metaSection.cityWidth = (u16)city.bounds.width();
+        metaSection.cityHeight = (u16)city.bounds.height();
+        metaSection.funds = city.funds;
+        metaSection.population = city.zoneLayer.total_residents();
+        metaSection.jobs = city.zoneLayer.total_jobs();
+
+        metaSection.cityName = writer.append_string(city.name);
+        metaSection.playerName = writer.append_string(city.playerName);
+
+        // Clock
+        auto& clock = city.gameClock;
+        metaSection.currentDate = clock.current_day();
+        metaSection.timeWithinDay = clock.current_day_completion();
+
+        // Camera
+        Camera& camera = the_renderer().world_camera();
+        metaSection.cameraX = camera.position().x;
+        metaSection.cameraY = camera.position().y;
+        metaSection.cameraZoom = camera.zoom();
+
+        writer.endSection(&metaSection);
+    }
+
+    if (patch.has_value()) {
+        writer.startSection<SAVSection_Patch>(SAV_PATCH_ID, SAV_PATCH_VERSION);
+        SAVSection_Patch patchSection = {};
+        patchSection.chainID = patch.value().chainID;
+        patchSection.patchIndex = patch.value().patchIndex;
+        writer.endSection(&patchSection);
+    }
+
+    city.terrainLayer.save(writer);
+    city.save_buildings(&writer);
+    city.zoneLayer.save(writer);
+
+    for (auto const& layer : city.m_layers)
+        layer->save(writer);
+
+    return writer;
+}
+
 bool write_save_file(FileHandle* file, City const& city)
 {
     bool succeeded = file->isOpen;
 
     if (succeeded) {
-        BinaryFileWriter writer = startWritingFile(SAV_FILE_ID, SAV_VERSION, &temp_arena());
-
-        // Prepare the TOC
-        writer.addTOCEntry(SAV_META_ID);
-        writer.addTOCEntry(SAV_BUILDING_ID);
-        writer.addTOCEntry(SAV_CRIME_ID);
-        writer.addTOCEntry(SAV_EDUCATION_ID);
-        writer.addTOCEntry(SAV_FIRE_ID);
-        writer.addTOCEntry(SAV_HEALTH_ID);
-        writer.addTOCEntry(SAV_LANDVALUE_ID);
-        writer.addTOCEntry(SAV_POLLUTION_ID);
-        writer.addTOCEntry(SAV_TERRAIN_ID);
-        writer.addTOCEntry(SAV_TRANSPORT_ID);
-        writer.addTOCEntry(SAV_ZONE_ID);
-
-        // Meta
+        BinaryFileWriter writer = serialise_city(city, &temp_arena());
         {
-            writer.startSection<SAVSection_Meta>(SAV_META_ID, SAV_META_VERSION);
-            SAVSection_Meta metaSection = {};
-
-            metaSection.saveTimestamp = get_current_unix_timestamp();
-            metaSection.cityWidth = (u16)city.bounds.width();
-            metaSection.cityHeight = (u16)city.bounds.height();
-            metaSection.funds = city.funds;
-            metaSection.population = city.zoneLayer.total_residents();
-            metaSection.jobs = city.zoneLayer.total_jobs();
-
-            metaSection.cityName = writer.append_string(city.name);
-            metaSection.playerName = writer.append_string(city.playerName);
-
-            // Clock
-            auto& clock = city.gameClock;
-            metaSection.currentDate = clock.current_day();
-            metaSection.timeWithinDay = clock.current_day_completion();
-
-            // Camera
-            Camera& camera = the_renderer().world_camera();
-            metaSection.cameraX = camera.position().x;
-            metaSection.cameraY = camera.position().y;
-            metaSection.cameraZoom = camera.zoom();
-
-            writer.endSection(&metaSection);
+            DEBUG_BLOCK("write_save_file compression");
+            writer.compressDeferredBlobs();
         }
+        writer.logCompressionStatistics();
+        succeeded = writer.outputToFile(file);
+    }
 
-        city.terrainLayer.save(writer);
-        city.save_buildings(&writer);
-        city.zoneLayer.save(writer);
+    return succeeded;
+}
 
-        for (auto const& layer : city.m_layers)
-            layer->save(writer);
+// Returns the chain ID, if the file is part of a chain, and it's at `patchIndex` within it.
+static Optional<u64> read_patch_chain_id(BinaryFileReader& reader, u32 patchIndex)
+{
+    if (!reader.hasSection(SAV_PATCH_ID))
+        return {};
 
-        succeeded = writer.outputToFile(file);
+    Optional<u64> result;
+    if (reader.startSection(SAV_PATCH_ID, SAV_PATCH_VERSION)) {
+        SAVSection_Patch* patchSection = reader.readStruct<SAVSection_Patch>(0);
+        if (patchSection && patchSection->patchIndex == patchIndex)
+            result = (u64)patchSection->chainID;
     }
+    reader.endSection();
 
-    return succeeded;
+    return result;
+}
+
+void open_saved_game_files(SavedGameFiles& files, String path, String saveName)
+{
+    ASSERT(files.count == 0);
+
+    auto open = [&files](String filePath) -> BinaryFileReader& {
+        s32 index = files.count++;
+        files.handles[index] = openFile(filePath, FileAccessMode::Read);
+        files.arenas[index] = MemoryArena { "SavedGameFile"_s };
+        files.readers[index] = readBinaryFile(&files.handles[index], SAV_FILE_ID, &files.arenas[index]);
+        return files.readers[index];
+    };
+
+    BinaryFileReader& base = open(path);
+    auto chainID = read_patch_chain_id(base, 0);
+    if (!chainID.has_value())
+        return;
+
+    for (s32 patchIndex = 1; patchIndex <= MAX_SAVE_PATCHES; patchIndex++) {
+        String patchPath = savedGamePatchPath(saveName, patchIndex);
+        FileHandle patchFile = openFile(patchPath, FileAccessMode::Read);
+        bool exists = patchFile.isOpen;
+        closeFile(&patchFile);
+        if (!exists)
+            break;
+
+        // A patch that's unreadable, or from a different chain, ends the chain. Anything after it can't be used either.
+        BinaryFileReader& patch = open(patchPath);
+        auto patchChainID = read_patch_chain_id(patch, patchIndex);
+        if (!patch.isValidFile || !patchChainID.has_value() || patchChainID.value() != chainID.value()) {
+            closeFile(&files.handles[--files.count]);
+            break;
+        }
+    }
+}
+
+SavedGameFiles::~SavedGameFiles()
+{
+    for (s32 i = 0; i < count; i++)
+        closeFile(&handles[i]);
 }
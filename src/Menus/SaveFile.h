@@ -7,10 +7,14 @@
 #pragma once
 
 #include <IO/BinaryFile.h>
+#include <IO/BinaryFileReader.h>
+#include <IO/File.h>
 #include <IO/Forward.h>
 #include <Sim/Forward.h>
 #include <Sim/GameClock.h>
 #include <Util/Basic.h>
+#include <Util/MemoryArena.h>
+#include <Util/Optional.h>
 
 //
 // A crazy, completely-unnecessary idea: we could implement a thumbnail handler so that
@@ -180,6 +184,54 @@ struct SAVSection_Zone {
     FileBlob tileZone; // Array of u8s
 };
 
+//
+// Autosaves are written as a chain of files: a full "base" save, followed by patches. A patch
+// contains every section that a normal save does, except that the tile arrays only hold the
+// sectors that changed since the previous file in the chain. (See FILE_BLOB_SECTOR_PATCH_FLAG.)
+// Everything else is small enough to just save in full every time.
+// So, loading reads the tile arrays from each file in turn, and everything else from the newest.
+// Every file in a chain has this section, so that we can tell which patches belong to which base.
+// A base without it is a normal save, and any patches lying around next to it are ignored.
+//
+u8 const SAV_PATCH_VERSION = 1;
+FileIdentifier const SAV_PATCH_ID = "PTCH"_id;
+struct SAVSection_Patch {
+    leU64 chainID;    // Shared by the base and its patches
+    leU32 patchIndex; // 0 for the base, then 1, 2, 3...
+};
+
 #pragma pack(pop)
 
+// After this many patches, the autosave writes a new base instead, so that loading doesn't have to read too many files.
+s32 const MAX_SAVE_PATCHES = 8;
+
+struct SavePatchInfo {
+    u64 chainID;
+    u32 patchIndex;
+};
+
+// Serialises the whole city into the writer, apart from compressing the blobs: call
+// compressDeferredBlobs() on the result before writing it out. Everything is copied into the writer's
+// arena, so once this returns, the city can keep changing without affecting what gets saved, and the
+// compression can happen on another thread.
+// If `patch` is given, the file is part of that chain. Unless it's the base, its tile arrays only
+// contain the sectors that changed since City::clear_unsaved_sectors() was last called.
+BinaryFileWriter serialise_city(City const& city, MemoryArena* arena, Optional<SavePatchInfo> patch = {});
 bool write_save_file(FileHandle* file, City const& city);
+
+// The files that make up a saved game: just the one, unless it's an autosave with patches.
+// Each file has its own arena, so they can all be read from at the same time.
+struct SavedGameFiles {
+    s32 count { 0 };
+    FileHandle handles[1 + MAX_SAVE_PATCHES];
+    MemoryArena arenas[1 + MAX_SAVE_PATCHES];
+    BinaryFileReader readers[1 + MAX_SAVE_PATCHES];
+
+    ~SavedGameFiles();
+
+    BinaryFileReader& base() { return readers[0]; }
+    BinaryFileReader& newest() { return readers[count - 1]; }
+    Span<BinaryFileReader> all() { return { (size_t)count, readers }; }
+};
+// Opens the saved game at `path`, along with any patches that belong to it.
+void open_saved_game_files(SavedGameFiles&, String path, String saveName);
@@ -19,6 +19,42 @@
 
 static SavedGamesCatalogue savedGamesCatalogue {};
 
+//
+// The on-disk cache of the catalogue. It's just what we last read from each save's META section,
+// along with the modification time and size of the files, so we can tell if it's still correct.
+//
+#pragma pack(push, 1)
+
+u8 const SAVED_GAMES_CACHE_VERSION = 1;
+FileIdentifier const SAVED_GAMES_CACHE_FILE_ID = "SAVC"_id;
+
+u8 const SAVED_GAMES_CACHE_SECTION_VERSION = 1;
+FileIdentifier const SAVED_GAMES_CACHE_SECTION_ID = "SAVS"_id;
+struct SavedGamesCacheSection {
+    FileArray savedGames; // SavedGamesCacheEntry
+};
+struct SavedGamesCacheEntry {
+    FileString shortName;
+    leS64 modifiedTime;
+    leS64 fileSize;
+
+    leU8 isReadable;
+    leU8 problems; // Flags<BinaryFileReader::Problems>
+
+    leU64 saveTimestamp;
+    FileString cityName;
+    FileString playerName;
+    leU16 cityWidth;
+    leU16 cityHeight;
+    leS32 funds;
+    leS32 population;
+};
+
+#pragma pack(pop)
+
+static void readSavedGamesCache(SavedGamesCatalogue* catalogue);
+static void writeSavedGamesCache(SavedGamesCatalogue* catalogue);
+
 void initSavedGamesCatalogue()
 {
     SavedGamesCatalogue* catalogue = &savedGamesCatalogue;
@@ -34,6 +70,9 @@ void initSavedGamesCatalogue()
         catalogue->savedGamesChangeHandle = saved_games_watcher.release_value();
     }
 
+    // The cache is hidden, so it doesn't show up as a saved game.
+    catalogue->cachePath = catalogue->stringsTable.intern(constructPath({ catalogue->savedGamesPath, ".saved-games-cache"_s }));
+
     catalogue->savedGames = { catalogue->savedGamesArena, 64 };
 
     // Window-related stuff
@@ -41,88 +80,298 @@ void initSavedGamesCatalogue()
     catalogue->selectedSavedGameIndex = -1;
     catalogue->saveGameName = UI::newTextInput(&catalogue->savedGamesArena, 64, "\\/:*?\"'`<>|[]()^#%&!@+={}~."_s);
 
-    // Initial saved-games scan
+    // Initial saved-games scan. Anything that's unchanged since the cache was written doesn't need opening.
+    readSavedGamesCache(catalogue);
     readSavedGamesInfo(catalogue);
 }
 
+// Autosave patches are named ".{saveName}.patch{N}.sav", see savedGamePatchPath().
+// Returns the saveName, or nothing if `filename` isn't a patch.
+static Optional<StringView> getPatchOwner(StringView filename)
+{
+    StringView name = get_file_name(filename);
+    if (!name.starts_with('.'))
+        return {};
+
+    auto lastDot = name.find('.', SearchFrom::End);
+    if (!lastDot.has_value() || lastDot.value() == 0)
+        return {};
+
+    StringView suffix = name.substring(lastDot.value() + 1);
+    if (!suffix.starts_with("patch"_sv) || !suffix.substring(5).to_int().has_value())
+        return {};
+
+    return name.substring(1, lastDot.value() - 1);
+}
+
+struct SavedGameStamp {
+    s64 modifiedTime;
+    smm fileSize;
+};
+
+// Combines the save file's info with its patches', so a new patch counts as a change to the save.
+// Returns nothing if the save file doesn't exist.
+static Optional<SavedGameStamp> getSavedGameStamp(String fullPath, String shortName)
+{
+    auto fileInfo = getFileInfo(fullPath);
+    if (!fileInfo.has_value() || fileInfo.value().flags.has(FileFlags::Directory))
+        return {};
+
+    SavedGameStamp stamp { fileInfo.value().modifiedTime, fileInfo.value().size };
+    for (s32 patchIndex = 1; patchIndex <= MAX_SAVE_PATCHES; patchIndex++) {
+        auto patchInfo = getFileInfo(savedGamePatchPath(shortName, patchIndex));
+        if (!patchInfo.has_value())
+            break;
+        stamp.modifiedTime = max(stamp.modifiedTime, patchInfo.value().modifiedTime);
+        stamp.fileSize += patchInfo.value().size;
+    }
+
+    return stamp;
+}
+
+static void readSavedGameInfo(SavedGamesCatalogue* catalogue, SavedGameInfo* savedGame, SavedGameStamp stamp)
+{
+    savedGame->modifiedTime = stamp.modifiedTime;
+    savedGame->fileSize = stamp.fileSize;
+    savedGame->isReadable = false;
+    savedGame->problems = {};
+
+    // Autosaves may have patches, and the newest one has the up-to-date META.
+    SavedGameFiles savedFiles;
+    open_saved_game_files(savedFiles, savedGame->fullPath, savedGame->shortName);
+    if (savedFiles.handles[0].isOpen) {
+        BinaryFileReader& reader = savedFiles.newest();
+        savedGame->problems = savedFiles.base().problems;
+
+        if (reader.isValidFile) {
+            // Read the META section, which is all we care about
+            bool readSection = reader.startSection(SAV_META_ID, SAV_META_VERSION);
+            if (readSection) {
+                SAVSection_Meta* meta = reader.readStruct<SAVSection_Meta>(0);
+
+                savedGame->saveTime = DateTime::from_unix_timestamp(meta->saveTimestamp);
+                savedGame->cityName = catalogue->stringsTable.intern(reader.readString(meta->cityName));
+                savedGame->playerName = catalogue->stringsTable.intern(reader.readString(meta->playerName));
+                savedGame->citySize = v2i(meta->cityWidth, meta->cityHeight);
+                savedGame->funds = meta->funds;
+                savedGame->population = meta->population;
+                savedGame->isReadable = true;
+            }
+        }
+    }
+}
+
+// Brings the catalogue up to date with one save file, which may have been added, changed or removed.
+// Returns whether the catalogue changed.
+static bool updateSavedGameInfo(SavedGamesCatalogue* catalogue, StringView shortName, String fullPath)
+{
+    auto existing = catalogue->savedGames.find_first([&](SavedGameInfo& info) {
+        return info.shortName == shortName;
+    });
+
+    auto stamp = getSavedGameStamp(fullPath, shortName.deprecated_to_string());
+    if (!stamp.has_value()) {
+        if (!existing.has_value())
+            return false;
+        (void)catalogue->savedGames.take_index(existing.value().index(), true);
+        return true;
+    }
+
+    if (existing.has_value()) {
+        auto& info = existing.value().value();
+        if (info.modifiedTime == stamp.value().modifiedTime && info.fileSize == stamp.value().fileSize)
+            return false;
+    }
+
+    SavedGameInfo* savedGame = existing.has_value() ? &existing.value().value() : catalogue->savedGames.appendBlank();
+    savedGame->shortName = catalogue->stringsTable.intern(shortName);
+    savedGame->fullPath = catalogue->stringsTable.intern(fullPath);
+    readSavedGameInfo(catalogue, savedGame, stamp.value());
+    return true;
+}
+
+// Call after changing the list of saved games. `needsCaching` is whether any of their info changed.
+static void savedGamesCatalogueChanged(SavedGamesCatalogue* catalogue, bool needsCaching)
+{
+    // Sort the saved games by most-recent first
+    catalogue->savedGames.sort([](SavedGameInfo& a, SavedGameInfo& b) {
+        return a.saveTime.unixTimestamp > b.saveTime.unixTimestamp;
+    });
+
+    // The selected save might have moved or gone.
+    // FIXME: Keep it selected by name instead.
+    if (catalogue->selectedSavedGameIndex >= catalogue->savedGames.count)
+        catalogue->selectedSavedGameIndex = -1;
+
+    if (needsCaching)
+        writeSavedGamesCache(catalogue);
+}
+
 void updateSavedGamesCatalogue()
 {
     SavedGamesCatalogue* catalogue = &savedGamesCatalogue;
 
-    auto has_changed = catalogue->savedGamesChangeHandle->has_changed();
-    if (has_changed.is_error()) {
-        logError("Failed to check for saved game changes: {}"_s, { has_changed.error() });
+    auto changes = catalogue->savedGamesChangeHandle->read_changes();
+    if (changes.is_error()) {
+        logError("Failed to check for saved game changes: {}"_s, { changes.error() });
         return;
     }
-    if (has_changed.value()) {
-        // TODO: @Speed Throwing the list away and starting over is unnecessary - if we could
-        // detect which file changed and only update that, it'd be much better!
-        // That'd mean using ReadDirectoryChangesW() instead of FindFirstChangeNotification() on win32.
-        // We probably want to do that, but for now we'll do the simple solution of using what
-        // we already have.
-        // - Sam, 13/11/2019
-
-        // Another option would be to scan the file-change times, and only update the ones that
-        // changed since the last read. (And also add any ones that were missing, and remove
-        // any that have been deleted.) This might not take much effort?
-        // - Sam, 25/03/2019
-
-        catalogue->savedGames.clear();
-        readSavedGamesInfo(catalogue);
+    if (changes.value().is_empty())
+        return;
+
+    for (auto const& change : changes.value()) {
+        if (change.kind == DirectoryChange::Kind::Unknown) {
+            readSavedGamesInfo(catalogue);
+            return;
+        }
     }
+
+    // Each change only tells us that something happened to a file, so we check what it looks like now.
+    // An autosave produces several changes for the same save, but only the first one finds it's different.
+    bool catalogueChanged = false;
+    for (auto const& change : changes.value()) {
+        if (!change.filename.starts_with('.')) {
+            String fullPath = constructPath({ catalogue->savedGamesPath, change.filename });
+            catalogueChanged |= updateSavedGameInfo(catalogue, get_file_name(change.filename), fullPath);
+        } else if (auto patchOwner = getPatchOwner(change.filename); patchOwner.has_value()) {
+            auto owner = catalogue->savedGames.find_first([&](SavedGameInfo& info) {
+                return info.shortName == patchOwner.value();
+            });
+            String fullPath = owner.has_value() ? owner.value().value().fullPath : savedGamePath(patchOwner.value().deprecated_to_string());
+            catalogueChanged |= updateSavedGameInfo(catalogue, patchOwner.value(), fullPath);
+        }
+        // Other hidden files, such as in-progress autosaves and our cache, aren't saved games.
+    }
+
+    if (catalogueChanged)
+        savedGamesCatalogueChanged(catalogue, true);
 }
 
 void readSavedGamesInfo(SavedGamesCatalogue* catalogue)
 {
-    // Load the save game metadata
     auto iterate = iterate_directory(constructPath({ catalogue->savedGamesPath }));
     if (iterate.is_error()) {
         logError("Failed to iterate saved games directory: {}"_s, { iterate.error() });
         return;
     }
+
+    // Build the new list, reusing the info we already have for any saves that haven't changed.
+    ChunkedArray<SavedGameInfo> savedGames { temp_arena(), 64 };
+    bool catalogueChanged = false;
     for (auto it : iterate.release_value()) {
         if (it.is_error()) {
             logError("Failed to iterate saved games directory: {}"_s, { it.error() });
-            break;
+            return;
         }
         auto& file_info = it.value();
         if (file_info.flags.has(FileFlags::Directory) || file_info.flags.has(FileFlags::Hidden))
             continue;
 
-        SavedGameInfo* savedGame = catalogue->savedGames.appendBlank();
-
-        savedGame->shortName = catalogue->stringsTable.intern(get_file_name(file_info.filename).deprecated_to_string());
-        savedGame->fullPath = catalogue->stringsTable.intern(constructPath({ catalogue->savedGamesPath, file_info.filename }));
-        savedGame->isReadable = false;
-
-        FileHandle savedFile = openFile(savedGame->fullPath, FileAccessMode::Read);
-        if (savedFile.isOpen) {
-            BinaryFileReader reader = readBinaryFile(&savedFile, SAV_FILE_ID, &temp_arena());
-            savedGame->problems = reader.problems;
-
-            if (reader.isValidFile) {
-                // Read the META section, which is all we care about
-                bool readSection = reader.startSection(SAV_META_ID, SAV_META_VERSION);
-                if (readSection) {
-                    SAVSection_Meta* meta = reader.readStruct<SAVSection_Meta>(0);
-
-                    savedGame->saveTime = DateTime::from_unix_timestamp(meta->saveTimestamp);
-                    savedGame->cityName = catalogue->stringsTable.intern(reader.readString(meta->cityName));
-                    savedGame->playerName = catalogue->stringsTable.intern(reader.readString(meta->playerName));
-                    savedGame->citySize = v2i(meta->cityWidth, meta->cityHeight);
-                    savedGame->funds = meta->funds;
-                    savedGame->population = meta->population;
-                    savedGame->isReadable = true;
+        String shortName = catalogue->stringsTable.intern(get_file_name(file_info.filename));
+        String fullPath = catalogue->stringsTable.intern(constructPath({ catalogue->savedGamesPath, file_info.filename }));
+
+        // If there's no stamp, it was deleted while we were looking.
+        auto stamp = getSavedGameStamp(fullPath, shortName);
+        if (!stamp.has_value())
+            continue;
+
+        auto existing = catalogue->savedGames.find_first([&](SavedGameInfo& info) {
+            return info.shortName == shortName;
+        });
+        SavedGameInfo* savedGame = savedGames.appendBlank();
+        if (existing.has_value()
+            && existing.value().value().modifiedTime == stamp.value().modifiedTime
+            && existing.value().value().fileSize == stamp.value().fileSize) {
+            *savedGame = existing.value().value();
+            savedGame->fullPath = fullPath;
+        } else {
+            savedGame->shortName = shortName;
+            savedGame->fullPath = fullPath;
+            readSavedGameInfo(catalogue, savedGame, stamp.value());
+            catalogueChanged = true;
+        }
+    }
+
+    catalogueChanged |= (savedGames.count != catalogue->savedGames.count);
+
+    catalogue->savedGames.clear();
+    for (auto it = savedGames.iterate(); it.hasNext(); it.next())
+        catalogue->savedGames.append(it.get());
+
+    // The directory listing isn't in any particular order, so this always needs sorting.
+    savedGamesCatalogueChanged(catalogue, catalogueChanged);
+}
+
+static void readSavedGamesCache(SavedGamesCatalogue* catalogue)
+{
+    FileHandle file = openFile(catalogue->cachePath, FileAccessMode::Read);
+    if (!file.isOpen)
+        return;
+
+    // Nothing's been read from the saves yet, so if the cache is no good, we just start from scratch.
+    BinaryFileReader reader = readBinaryFile(&file, SAVED_GAMES_CACHE_FILE_ID, &temp_arena());
+    if (reader.isValidFile && reader.startSection(SAVED_GAMES_CACHE_SECTION_ID, SAVED_GAMES_CACHE_SECTION_VERSION)) {
+        SavedGamesCacheSection* section = reader.readStruct<SavedGamesCacheSection>(0);
+        auto entries = section ? reader.readArray<SavedGamesCacheEntry>(section->savedGames) : Optional<ReadonlySpan<SavedGamesCacheEntry>> {};
+        if (entries.has_value()) {
+            for (auto const& entry : entries.value()) {
+                SavedGameInfo* savedGame = catalogue->savedGames.appendBlank();
+                savedGame->shortName = catalogue->stringsTable.intern(reader.readString(entry.shortName));
+                savedGame->fullPath = catalogue->stringsTable.intern(savedGamePath(savedGame->shortName)); // Corrected by the directory scan
+                savedGame->modifiedTime = entry.modifiedTime;
+                savedGame->fileSize = entry.fileSize;
+                savedGame->isReadable = entry.isReadable != 0;
+                for (auto problem : enum_values<BinaryFileReader::Problems>()) {
+                    if (entry.problems & (1u << to_underlying(problem)))
+                        savedGame->problems.add(problem);
                 }
+                savedGame->saveTime = DateTime::from_unix_timestamp(entry.saveTimestamp);
+                savedGame->cityName = catalogue->stringsTable.intern(reader.readString(entry.cityName));
+                savedGame->playerName = catalogue->stringsTable.intern(reader.readString(entry.playerName));
+                savedGame->citySize = v2i(entry.cityWidth, entry.cityHeight);
+                savedGame->funds = entry.funds;
+                savedGame->population = entry.population;
             }
         }
-        closeFile(&savedFile);
     }
 
-    // Sort the saved games by most-recent first
-    catalogue->savedGames.sort([](SavedGameInfo& a, SavedGameInfo& b) {
-        return a.saveTime.unixTimestamp > b.saveTime.unixTimestamp;
-    });
+    closeFile(&file);
+}
+
+static void writeSavedGamesCache(SavedGamesCatalogue* catalogue)
+{
+    BinaryFileWriter writer = startWritingFile(SAVED_GAMES_CACHE_FILE_ID, SAVED_GAMES_CACHE_VERSION, &temp_arena());
+    writer.addTOCEntry(SAVED_GAMES_CACHE_SECTION_ID);
+
+    writer.startSection<SavedGamesCacheSection>(SAVED_GAMES_CACHE_SECTION_ID, SAVED_GAMES_CACHE_SECTION_VERSION);
+    SavedGamesCacheSection section = {};
+
+    Array<SavedGamesCacheEntry> entries = temp_arena().allocate_array<SavedGamesCacheEntry>(catalogue->savedGames.count);
+    for (auto it = catalogue->savedGames.iterate(); it.hasNext(); it.next()) {
+        auto& savedGame = it.get();
+        SavedGamesCacheEntry* entry = entries.append();
+        entry->shortName = writer.append_string(savedGame.shortName);
+        entry->modifiedTime = savedGame.modifiedTime;
+        entry->fileSize = savedGame.fileSize;
+        entry->isReadable = savedGame.isReadable ? 1 : 0;
+        entry->problems = savedGame.problems;
+        entry->saveTimestamp = savedGame.saveTime.unixTimestamp;
+        entry->cityName = writer.append_string(savedGame.cityName);
+        entry->playerName = writer.append_string(savedGame.playerName);
+        entry->cityWidth = (u16)savedGame.citySize.x;
+        entry->cityHeight = (u16)savedGame.citySize.y;
+        entry->funds = savedGame.funds;
+        entry->population = savedGame.population;
+    }
+    section.savedGames = writer.appendArray(entries);
+
+    writer.endSection(&section);
+
+    // The cache is only an optimisation, so if this fails, we'll just read the saves again next time.
+    FileHandle file = openFile(catalogue->cachePath, FileAccessMode::Write);
+    if (!file.isOpen || !writer.outputToFile(&file))
+        logWarn("Failed to write saved games cache to '{0}'."_s, { catalogue->cachePath });
+    closeFile(&file);
 }
 
 void showLoadGameWindow()
@@ -339,6 +588,21 @@ void loadGame(SavedGameInfo const& saved_game)
     savedGamesCatalogue.activeSavedGameName = saved_game.shortName;
 }
 
+String savedGamePath(String saveName)
+{
+    String saveFilename = saveName;
+    if (!saveFilename.ends_with(".sav"_s)) {
+        saveFilename = String::join({ saveName, ".sav"_s });
+    }
+
+    return constructPath({ savedGamesCatalogue.savedGamesPath, saveFilename });
+}
+
+String savedGamePatchPath(String saveName, s32 patchIndex)
+{
+    return savedGamePath(myprintf(".{0}.patch{1}"_s, { saveName, formatInt(patchIndex) }));
+}
+
 bool saveGame(String saveName)
 {
     auto* game_scene = dynamic_cast<GameScene*>(&App::the().scene());
@@ -347,12 +611,7 @@ bool saveGame(String saveName)
     auto& city = *game_scene->city();
     SavedGamesCatalogue* catalogue = &savedGamesCatalogue;
 
-    String saveFilename = saveName;
-    if (!saveFilename.ends_with(".sav"_s)) {
-        saveFilename = String::join({ saveName, ".sav"_s });
-    }
-
-    String savePath = constructPath({ catalogue->savedGamesPath, saveFilename });
+    String savePath = savedGamePath(saveName);
     FileHandle saveFile = openFile(savePath, FileAccessMode::Write);
     bool saveSucceeded = write_save_file(&saveFile, city);
     closeFile(&saveFile);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2025, Sam Atkins <sam@samatkins.co.uk>
+ * Copyright (c) 2019-2026, Sam Atkins <sam@samatkins.co.uk>
  *
  * SPDX-License-Identifier: BSD-2-Clause
  */
@@ -25,6 +25,11 @@ struct SavedGameInfo {
 
     Flags<BinaryFileReader::Problems> problems;
 
+    // The newest modification time, and total size, of the save file and any autosave patches it has,
+    // when we read them. If these change, the info needs reading again.
+    s64 modifiedTime;
+    smm fileSize;
+
     // City properties
     String cityName;
     String playerName;
@@ -38,6 +43,8 @@ struct SavedGamesCatalogue {
 
     // Rather than scan the save files directory every time we need it, we maintain
     // a list of saved games here, which updates when the files change.
+    // The list is also cached on disk, so that we only have to open the saves that changed
+    // since the game last ran.
 
     MemoryArena savedGamesArena;
     StringTable stringsTable;
@@ -45,6 +52,7 @@ struct SavedGamesCatalogue {
     // FIXME: This should be nonnull and initialized on construction.
     OwnedPtr<DirectoryWatcher> savedGamesChangeHandle;
     String savedGamesPath;
+    String cachePath;
 
     ChunkedArray<SavedGameInfo> savedGames;
 
@@ -60,8 +68,12 @@ struct SavedGamesCatalogue {
 
 void initSavedGamesCatalogue();
 void updateSavedGamesCatalogue();
+// Rescans the whole saves directory. Only saves that changed since we last read them are opened.
 void readSavedGamesInfo(SavedGamesCatalogue* catalogue);
 
+String savedGamePath(String saveName);
+// Autosave patches are hidden, so they don't show up as saved games in their own right.
+String savedGamePatchPath(String saveName, s32 patchIndex);
 bool saveGame(String saveName);
 void loadGame(SavedGameInfo const&);
 bool deleteSave(SavedGameInfo& savedGame);
@@ -26,63 +26,69 @@ bool BuildingDef::has_type(BuildingType type) const
     return false;
 }
 
-bool BuildingDef::matches_variant(BuildingVariant const& variant, EnumMap<ConnectionDirection, Optional<BuildingDef const&>> const& neighbour_defs) const
+s32 BuildingDef::variant_lookup_size(bool is_intersection)
+{
+    return 1 << (to_underlying(ConnectionDirection::COUNT) * (is_intersection ? 2 : 1));
+}
+
+u32 BuildingDef::connection_bits_for_neighbour(BuildingDef const& neighbour_def) const
+{
+    if (isIntersection) {
+        return (neighbour_def.has_type(intersectionPart1TypeID) ? 1 : 0)
+            | (neighbour_def.has_type(intersectionPart2TypeID) ? 2 : 0);
+    }
+
+    return neighbour_def.has_type(typeID) ? 1 : 0;
+}
+
+static bool connection_matches(ConnectionType connection_type, u32 connection_bits)
+{
+    switch (connection_type) {
+    case ConnectionType::Nothing:
+        return connection_bits == 0;
+    case ConnectionType::Building1:
+        return (connection_bits & 1) != 0;
+    case ConnectionType::Building2:
+        return (connection_bits & 2) != 0;
+    case ConnectionType::Anything:
+        return true;
+    }
+    return false;
+}
+
+void BuildingDef::build_variant_lookup()
 {
     DEBUG_FUNCTION();
 
-    bool result = true;
-
-    for (auto direction : enum_values<ConnectionDirection>()) {
-        bool matchedDirection = false;
-        ConnectionType connectionType = variant.connections[direction];
-        auto& neighbourDef = neighbour_defs[direction];
-
-        if (!neighbourDef.has_value()) {
-            matchedDirection = (connectionType == ConnectionType::Nothing) || (connectionType == ConnectionType::Anything);
-        } else {
-            switch (connectionType) {
-            case ConnectionType::Nothing: {
-                if (isIntersection) {
-                    matchedDirection = !neighbourDef->has_type(intersectionPart1TypeID)
-                        && !neighbourDef->has_type(intersectionPart2TypeID);
-                } else {
-                    matchedDirection = !neighbourDef->has_type(typeID);
-                }
-            } break;
+    if (variants.is_empty())
+        return;
 
-            case ConnectionType::Building1: {
-                if (isIntersection) {
-                    matchedDirection = neighbourDef->has_type(intersectionPart1TypeID);
-                } else {
-                    matchedDirection = neighbourDef->has_type(typeID);
-                }
-            } break;
+    s32 bits_per_direction = isIntersection ? 2 : 1;
+    u32 direction_mask = (1 << bits_per_direction) - 1;
 
-            case ConnectionType::Building2: {
-                if (isIntersection) {
-                    matchedDirection = neighbourDef->has_type(intersectionPart2TypeID);
-                } else {
-                    matchedDirection = false;
-                }
-            } break;
+    for (u32 signature = 0; signature < variantLookup.count(); signature++) {
+        // Variants are checked in order, so the first one that matches wins.
+        u8 matched_variant = no_matching_variant;
+        for (s32 variant_index = 0; variant_index < variants.count(); variant_index++) {
+            auto& variant = variants[variant_index];
 
-            case ConnectionType::Anything: {
-                matchedDirection = true;
-            } break;
+            bool matches = true;
+            for (auto direction : enum_values<ConnectionDirection>()) {
+                u32 connection_bits = (signature >> (to_underlying(direction) * bits_per_direction)) & direction_mask;
+                if (!connection_matches(variant.connections[direction], connection_bits)) {
+                    matches = false;
+                    break;
+                }
+            }
 
-            default: {
-                matchedDirection = false;
-            } break;
+            if (matches) {
+                matched_variant = variant_index;
+                break;
             }
         }
 
-        if (!matchedDirection) {
-            result = false;
-            break;
-        }
+        variantLookup[signature] = matched_variant;
     }
-
-    return result;
 }
 
 void Building::update_variant(City& city, Optional<BuildingDef const&> passed_def)
@@ -104,24 +110,20 @@ void Building::update_variant(City& city, Optional<BuildingDef const&> passed_de
         s32 y = footprint.y();
 
         static_assert(to_underlying(ConnectionDirection::COUNT) == 8, "updateBuildingVariant() assumes ConnectionDirectionCount == 8");
-        EnumMap<ConnectionDirection, Optional<BuildingDef const&>> neighbourDefs;
+        s32 bits_per_direction = def.isIntersection ? 2 : 1;
+        u32 signature = 0;
         for (auto direction : enum_values<ConnectionDirection>()) {
             if (auto* building_in_direction = city.get_building_at(x + connection_offsets[direction].x, y + connection_offsets[direction].y)) {
-                neighbourDefs[direction] = building_in_direction->get_def();
+                signature |= def.connection_bits_for_neighbour(building_in_direction->get_def()) << (to_underlying(direction) * bits_per_direction);
             }
         }
 
-        // Search for a matching variant
-        // Right now... YAY LINEAR SEARCH! @Speed
+        // Look up the matching variant, which was calculated when the def was loaded.
         bool foundVariant = false;
-        for (s32 variant_index = 0; variant_index < def.variants.count(); variant_index++) {
-            auto& variant = def.variants[variant_index];
-            if (def.matches_variant(variant, neighbourDefs)) {
-                this->variantIndex = variant_index;
-                foundVariant = true;
-                logInfo("Matched building {0}#{1} with variant #{2}"_s, { def.name, formatInt(id), formatInt(variant_index) });
-                break;
-            }
+        if (u8 variant_index = def.variantLookup[signature]; variant_index != BuildingDef::no_matching_variant) {
+            this->variantIndex = variant_index;
+            foundVariant = true;
+            logInfo("Matched building {0}#{1} with variant #{2}"_s, { def.name, formatInt(id), formatInt(variant_index) });
         }
 
         if (!foundVariant) {
@@ -149,95 +151,102 @@ Building::Building(s32 id, BuildingDef const& def, Rect2I footprint, GameTimesta
 {
 }
 
-void Building::update(City& city)
+BuildingTickData::BuildingTickData(MemoryArena& arena, s32 capacity)
+    : arena(&arena)
+    , typeID(arena.allocate_filled_array<BuildingType>(capacity))
+    , footprint(arena.allocate_filled_array<Rect2I>(capacity))
+    , allocatedPower(arena.allocate_filled_array<s32>(capacity))
+    , problems(arena.allocate_filled_array<Flags<BuildingProblem::Type>>(capacity))
 {
-    auto& def = get_def();
-
-    // Check the building's needs are met
-    // ... except for the ones that are checked by layers.
-
-    // Distance to road
-    // TODO: Replace with access to any transport types, instead of just road? Not sure what we want with that.
-    if ((def.flags.has(BuildingFlags::RequiresTransportConnection)) || (def.growsInZone != ZoneType::None)) {
-        s32 distanceToRoad = s32Max;
-        // TODO: @Speed: We only actually need to check the boundary tiles, because they're guaranteed to be less than
-        // the inner tiles... unless we allow multiple buildings per tile. Actually maybe we do? I'm not sure how that
-        // would work really. Anyway, can think about that later.
-        // - Sam, 30/08/2019
-        for (s32 y = footprint.y(); y < footprint.y() + footprint.height(); y++) {
-            for (s32 x = footprint.x(); x < footprint.x() + footprint.width(); x++) {
-                distanceToRoad = min(distanceToRoad, city.transportLayer.distance_to_transport(x, y, TransportType::Road));
-            }
-        }
+    for (auto problem_type : enum_values<BuildingProblem::Type>())
+        buildingsWithProblem[problem_type] = { arena, capacity };
+}
 
-        if (def.growsInZone != ZoneType::None) {
-            // Zoned buildings inherit their zone's max distance to road.
-            if (distanceToRoad > ZONE_DEFS[def.growsInZone].maximumDistanceToRoad) {
-                add_problem(BuildingProblem::Type::NoTransportAccess, city);
-            } else {
-                remove_problem(BuildingProblem::Type::NoTransportAccess);
-            }
-        } else if (def.flags.has(BuildingFlags::RequiresTransportConnection)) {
-            // Other buildings require direct contact
-            if (distanceToRoad > 1) {
-                add_problem(BuildingProblem::Type::NoTransportAccess, city);
-            } else {
-                remove_problem(BuildingProblem::Type::NoTransportAccess);
-            }
-        }
+void BuildingTickData::ensure_capacity(s32 required_capacity)
+{
+    s32 old_capacity = capacity();
+    if (required_capacity <= old_capacity)
+        return;
+
+    // NB: The old arrays stay allocated in the arena, but as we at least double each time, that's at most
+    // as much again as the final ones.
+    BuildingTickData grown { *arena, max(required_capacity, old_capacity * 2) };
+    copyMemory(typeID.raw_items(), grown.typeID.raw_items(), old_capacity);
+    copyMemory(footprint.raw_items(), grown.footprint.raw_items(), old_capacity);
+    copyMemory(allocatedPower.raw_items(), grown.allocatedPower.raw_items(), old_capacity);
+    copyMemory(problems.raw_items(), grown.problems.raw_items(), old_capacity);
+    for (auto problem_type : enum_values<BuildingProblem::Type>()) {
+        for (auto it = buildingsWithProblem[problem_type].iterate_set_bits(); it.has_next(); it.next())
+            grown.buildingsWithProblem[problem_type].set_bit(it.get_index());
     }
 
-    // Fire!
-    if (city.fireLayer.does_area_contain_fire(footprint)) {
-        add_problem(BuildingProblem::Type::Fire, city);
-    } else {
-        remove_problem(BuildingProblem::Type::Fire);
-    }
+    *this = grown;
+}
 
-    // Power!
-    if (def.power < 0) {
-        if (-def.power > allocatedPower) {
-            add_problem(BuildingProblem::Type::NoPower, city);
-        } else {
-            remove_problem(BuildingProblem::Type::NoPower);
-        }
-    }
+void BuildingTickData::add(s32 building_index, BuildingType type, Rect2I building_footprint)
+{
+    typeID[building_index] = type;
+    footprint[building_index] = building_footprint;
+    allocatedPower[building_index] = 0;
+    ASSERT(problems[building_index].is_empty());
+}
 
-    // Now, colour the building based on its problems
-    auto drawColorNormal = Colour::white();
-    auto drawColorNoPower = Colour::from_rgb_255(32, 32, 64, 255);
+void BuildingTickData::remove(s32 building_index)
+{
+    for (auto problem_type : enum_values<BuildingProblem::Type>())
+        remove_problem(building_index, problem_type);
 
-    if (!has_power()) {
-        entity->color = drawColorNoPower;
-    } else {
-        entity->color = drawColorNormal;
-    }
+    typeID[building_index] = 0;
+    footprint[building_index] = {};
+    allocatedPower[building_index] = 0;
+}
+
+void BuildingTickData::add_problem(s32 building_index, BuildingProblem::Type problem_type)
+{
+    problems[building_index].add(problem_type);
+    buildingsWithProblem[problem_type].set_bit(building_index);
+}
+
+void BuildingTickData::remove_problem(s32 building_index, BuildingProblem::Type problem_type)
+{
+    problems[building_index].remove(problem_type);
+    buildingsWithProblem[problem_type].unset_bit(building_index);
+}
+
+void Building::set_type(BuildingType type, City& city)
+{
+    typeID = type;
+    city.buildingTickData.typeID[index] = type;
 }
 
 void Building::add_problem(BuildingProblem::Type problem_type, City& city)
 {
-    auto& problem = problems[problem_type];
-    if (!problem.isActive) {
-        problem.isActive = true;
-        problem.type = problem_type;
-        problem.startDate = city.gameClock.current_day();
+    if (!has_problem(problem_type, city)) {
+        city.buildingTickData.add_problem(index, problem_type);
+        problemStartDates[problem_type] = city.gameClock.current_day();
+
+        if (problem_type == BuildingProblem::Type::NoPower)
+            entity->color = Colour::from_rgb_255(32, 32, 64, 255);
     }
 
     // TODO: Update zots!
 }
 
-void Building::remove_problem(BuildingProblem::Type problem_type)
+void Building::remove_problem(BuildingProblem::Type problem_type, City& city)
 {
-    if (problems[problem_type].isActive) {
-        problems[problem_type].isActive = false;
+    if (has_problem(problem_type, city)) {
+        city.buildingTickData.remove_problem(index, problem_type);
+
+        if (problem_type == BuildingProblem::Type::NoPower)
+            entity->color = Colour::white();
 
         // TODO: Update zots!
     }
 }
 
-bool Building::has_problem(BuildingProblem::Type problem_type) const
+bool Building::has_problem(BuildingProblem::Type problem_type, City const& city) const
 {
-    return problems[problem_type].isActive;
+    return city.buildingTickData.problems[index].has(problem_type);
 }
 
 void Building::load_sprite()
@@ -300,9 +309,19 @@ s32 Building::required_power() const
     return 0;
 }
 
-bool Building::has_power() const
+s32 Building::allocated_power(City const& city) const
+{
+    return city.buildingTickData.allocatedPower[index];
+}
+
+void Building::set_allocated_power(s32 allocated_power, City& city)
+{
+    city.buildingTickData.allocatedPower[index] = allocated_power;
+}
+
+bool Building::has_power(City const& city) const
 {
-    return !has_problem(BuildingProblem::Type::NoPower);
+    return !has_problem(BuildingProblem::Type::NoPower, city);
 }
 
 BuildingRef Building::get_reference() const
@@ -11,6 +11,8 @@
 #include <Sim/GameClock.h>
 #include <Sim/TileUtils.h>
 #include <Sim/Transport.h>
+#include <Util/Array.h>
+#include <Util/BitArray.h>
 #include <Util/EnumMap.h>
 #include <Util/Flags.h>
 
@@ -78,6 +80,11 @@ struct BuildingDef {
     V2I size;
     String spriteName;
     Array<BuildingVariant> variants;
+    // Index of the first variant matching each neighbour signature, or no_matching_variant.
+    // A signature has connection_bits_for_neighbour() for each ConnectionDirection, packed
+    // 1 bit per direction for regular buildings, and 2 bits per direction for intersections.
+    Array<u8> variantLookup;
+    static constexpr u8 no_matching_variant = 0xFF;
 
     BuildMethod buildMethod;
     s32 buildCost;
@@ -115,7 +122,10 @@ struct BuildingDef {
     // copy their values when a building `extends` a template!
 
     bool has_type(BuildingType) const;
-    bool matches_variant(BuildingVariant const& variant, EnumMap<ConnectionDirection, Optional<BuildingDef const&>> const&) const;
+
+    static s32 variant_lookup_size(bool is_intersection);
+    u32 connection_bits_for_neighbour(BuildingDef const& neighbour_def) const;
+    void build_variant_lookup();
 };
 
 struct BuildingProblem {
@@ -127,9 +137,6 @@ struct BuildingProblem {
         COUNT
     };
 
-    bool isActive;
-    Type type;
-    GameTimestamp startDate;
 };
 
 EnumMap<BuildingProblem::Type, String> const buildingProblemNames {
@@ -138,11 +145,41 @@ EnumMap<BuildingProblem::Type, String> const buildingProblemNames {
     "building_problem_no_transport"_s
 };
 
+// The per-building state that City::update() checks every tick, kept in parallel arrays indexed by
+// building index (the same index as City::buildings and City::tileBuildingIndex), so that the update
+// sweep only has to touch the Building itself when a problem starts or stops.
+struct BuildingTickData {
+    BuildingTickData() = default;
+    BuildingTickData(MemoryArena&, s32 capacity);
+
+    s32 capacity() const { return truncate32(typeID.count()); }
+    // Makes room for building indices below `required_capacity`, keeping what's already there.
+    void ensure_capacity(s32 required_capacity);
+
+    void add(s32 building_index, BuildingType, Rect2I footprint);
+    void remove(s32 building_index);
+
+    void add_problem(s32 building_index, BuildingProblem::Type);
+    void remove_problem(s32 building_index, BuildingProblem::Type);
+
+    MemoryArena* arena { nullptr };
+
+    Array<BuildingType> typeID; // 0 for an empty slot
+    Array<Rect2I> footprint;
+    Array<s32> allocatedPower;
+    Array<Flags<BuildingProblem::Type>> problems;
+
+    // The same as `problems`, but per problem type, so we can find all the buildings with a given
+    // problem without checking every building.
+    EnumMap<BuildingProblem::Type, BitArray> buildingsWithProblem;
+};
+
 struct Building {
     // FIXME: Temporary until OccupancyArray can construct items properly.
     Building() = default;
     Building(s32 id, BuildingDef const&, Rect2I footprint, GameTimestamp);
 
+    s32 index; // Our index in City::buildings
     u32 id;
     BuildingType typeID;
     GameTimestamp creationDate;
@@ -152,24 +189,26 @@ struct Building {
     Entity* entity;
     u16 spriteOffset; // used as the offset for getSprite
 
+    s32 ownerSectorIndex; // Our index in the owner CitySector's ownedBuildings
+
     s32 currentResidents;
     s32 currentJobs;
 
-    s32 allocatedPower;
-
-    EnumMap<BuildingProblem::Type, BuildingProblem> problems;
+    // NB: Whether each problem is active lives in City::buildingTickData.
+    EnumMap<BuildingProblem::Type, GameTimestamp> problemStartDates;
 
     BuildingRef get_reference() const;
     BuildingDef const& get_def() const;
-
-    void update(City&);
+    void set_type(BuildingType, City&);
 
     void add_problem(BuildingProblem::Type, City&);
-    void remove_problem(BuildingProblem::Type);
-    bool has_problem(BuildingProblem::Type) const;
+    void remove_problem(BuildingProblem::Type, City&);
+    bool has_problem(BuildingProblem::Type, City const&) const;
 
     s32 required_power() const;
-    bool has_power() const;
+    s32 allocated_power(City const&) const;
+    void set_allocated_power(s32, City&);
+    bool has_power(City const&) const;
 
     void load_sprite();
     void update_variant(City&, Optional<BuildingDef const&>);
@@ -68,19 +68,48 @@ Optional<BuildingDef const&> BuildingCatalogue::find_building_intersection(Build
 {
     DEBUG_FUNCTION();
 
-    // It's horrible linear search time!
+    if (auto intersection = intersectionsByParts.get(intersection_key(a.typeID, b.typeID)); intersection.has_value())
+        return *intersection.value();
+
+    return {};
+}
+
+u64 BuildingCatalogue::intersection_key(BuildingType a, BuildingType b)
+{
+    // The parts can be given in either order, so put the lowest first.
+    return (static_cast<u64>(min(a, b)) << 32) | max(a, b);
+}
+
+void BuildingCatalogue::update_intersections()
+{
+    DEBUG_FUNCTION();
+
+    intersectionsByParts.clear();
+
     for (auto it = intersectionBuildings.iterate(); it.hasNext(); it.next()) {
-        BuildingDef* itDef = it.getValue();
+        BuildingDef* def = it.getValue();
+        ASSERT(def->isIntersection);
 
-        if (itDef->isIntersection) {
-            if ((itDef->intersectionPart1TypeID == a.typeID && itDef->intersectionPart2TypeID == b.typeID)
-                || (itDef->intersectionPart2TypeID == a.typeID && itDef->intersectionPart1TypeID == b.typeID)) {
-                return *itDef;
-            }
+        BuildingDef* part1Def = findBuildingDef(def->intersectionPart1Name);
+        BuildingDef* part2Def = findBuildingDef(def->intersectionPart2Name);
+
+        if (part1Def == nullptr) {
+            logError("Unable to find building named '{0}' for part 1 of intersection '{1}'."_s, { def->intersectionPart1Name, def->name });
+            def->intersectionPart1TypeID = 0;
+        } else {
+            def->intersectionPart1TypeID = part1Def->typeID;
         }
-    }
 
-    return {};
+        if (part2Def == nullptr) {
+            logError("Unable to find building named '{0}' for part 2 of intersection '{1}'."_s, { def->intersectionPart2Name, def->name });
+            def->intersectionPart2TypeID = 0;
+        } else {
+            def->intersectionPart2TypeID = part2Def->typeID;
+        }
+
+        // If there are several intersections of the same parts, the first one wins, same as the linear search we used to do.
+        intersectionsByParts.ensure(intersection_key(def->intersectionPart1TypeID, def->intersectionPart2TypeID), [def] { return def; });
+    }
 }
 
 Optional<BuildingDef const&> BuildingCatalogue::find_random_zone_building(ZoneType zone_type, Random& random, Function<bool(BuildingDef const&)> filter) const
@@ -122,6 +151,8 @@ Optional<BuildingDef const&> BuildingCatalogue::find_random_zone_building(ZoneTy
 
 void BuildingCatalogue::after_assets_loaded()
 {
+    update_intersections();
+
     if (auto* game_scene = dynamic_cast<GameScene*>(&App::the().scene())) {
         if (auto* city = game_scene->city())
             remap_building_types(*city);
@@ -167,30 +198,6 @@ BuildingDef* findBuildingDef(String name)
 void saveBuildingTypes()
 {
     auto& building_catalogue = BuildingCatalogue::the();
-    // Post-processing of BuildingDefs
-    for (auto it = building_catalogue.allBuildings.iterate(); it.hasNext(); it.next()) {
-        auto def = it.get();
-        if (def->isIntersection) {
-            BuildingDef* part1Def = findBuildingDef(def->intersectionPart1Name);
-            BuildingDef* part2Def = findBuildingDef(def->intersectionPart2Name);
-
-            if (part1Def == nullptr) {
-                logError("Unable to find building named '{0}' for part 1 of intersection '{1}'."_s, { def->intersectionPart1Name, def->name });
-                def->intersectionPart1TypeID = 0;
-            } else {
-                def->intersectionPart1TypeID = part1Def->typeID;
-            }
-
-            if (part2Def == nullptr) {
-                logError("Unable to find building named '{0}' for part 2 of intersection '{1}'."_s, { def->intersectionPart2Name, def->name });
-                def->intersectionPart2TypeID = 0;
-            } else {
-                def->intersectionPart2TypeID = part2Def->typeID;
-            }
-        }
-    }
-
-    // Actual saving
     building_catalogue.buildingNameToOldTypeID.set_all(building_catalogue.buildingNameToTypeID);
 }
 
@@ -214,7 +221,7 @@ void BuildingCatalogue::remap_building_types(City& city)
             Building* building = it.get();
             auto oldType = building->typeID;
             if (oldType < oldTypeToNewType.count() && (oldTypeToNewType[oldType] != 0)) {
-                building->typeID = oldTypeToNewType[oldType];
+                building->set_type(oldTypeToNewType[oldType], city);
             }
         }
     }
@@ -36,6 +36,8 @@ struct BuildingCatalogue final : public AssetManagerListener {
     ChunkedArray<BuildingDef*> cGrowableBuildings;
     ChunkedArray<BuildingDef*> iGrowableBuildings;
     ChunkedArray<BuildingDef*> intersectionBuildings;
+    // Keyed by intersection_key() of the two parts' typeIDs
+    HashMap<u64, BuildingDef*> intersectionsByParts { 64 };
 
     s32 maxRBuildingDim;
     s32 maxCBuildingDim;
@@ -46,6 +48,10 @@ struct BuildingCatalogue final : public AssetManagerListener {
     virtual void after_assets_loaded() override;
 
     void remap_building_types(City& city);
+
+private:
+    static u64 intersection_key(BuildingType a, BuildingType b);
+    void update_intersections();
 };
 
 void initBuildingCatalogue(MemoryArena&);
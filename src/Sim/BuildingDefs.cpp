@@ -64,22 +64,33 @@ ErrorOr<OwnedRef<BuildingDefs>> BuildingDefs::load(AssetMetadata& metadata, Blob
 
     // Count the number of building defs in the file first, so we can allocate the building_ids array in the asset
     size_t buildingCount = 0;
-    // Same for variants as they have their own structs
+    // Same for variants as they have their own structs, and the variant lookup tables
     s32 totalVariantCount = 0;
+    smm variantLookupsSize = 0;
+    bool currentDefIsIntersection = false;
+    bool currentDefHasVariants = false;
     while (reader.load_next_line()) {
         auto command = reader.next_token();
-        if (command == ":Building"_s || command == ":Intersection"_s) {
-            buildingCount++;
+        if (command == ":Building"_s || command == ":Intersection"_s || command == ":Template"_s) {
+            if (command != ":Template"_s)
+                buildingCount++;
+            currentDefIsIntersection = (command == ":Intersection"_s);
+            currentDefHasVariants = false;
         } else if (command == "variant"_s) {
             totalVariantCount++;
+            if (!currentDefHasVariants) {
+                variantLookupsSize += BuildingDef::variant_lookup_size(currentDefIsIntersection);
+                currentDefHasVariants = true;
+            }
         }
     }
 
     smm buildingNamesSize = sizeof(String) * buildingCount;
     smm variantsSize = sizeof(BuildingVariant) * totalVariantCount;
-    auto data = asset_manager().allocate_blob(buildingNamesSize + variantsSize);
+    auto data = asset_manager().allocate_blob(buildingNamesSize + variantsSize + variantLookupsSize);
     Array<String> building_ids { buildingCount, reinterpret_cast<String*>(data.writable_data()) };
     u8* variantsMemory = data.writable_data() + buildingNamesSize;
+    u8* variantLookupsMemory = variantsMemory + variantsSize;
 
     reader.restart();
 
@@ -100,6 +111,7 @@ ErrorOr<OwnedRef<BuildingDefs>> BuildingDefs::load(AssetMetadata& metadata, Blob
 
             if (def != nullptr) {
                 // Now that the previous building is done, we can categorise it
+                def->build_variant_lookup();
                 assign_building_categories(*catalogue, *def);
             }
 
@@ -137,8 +149,16 @@ ErrorOr<OwnedRef<BuildingDefs>> BuildingDefs::load(AssetMetadata& metadata, Blob
             // Read ahead to count how many variants this building/intersection has.
             auto variant_count = reader.count_occurrences_of_property_in_current_command("variant"_s);
             if (variant_count > 0) {
+                if (variant_count >= BuildingDef::no_matching_variant)
+                    return reader.make_error_message("Too many variants for building '{0}'!"_s, { def->name });
+
                 def->variants = { variant_count, reinterpret_cast<BuildingVariant*>(variantsMemory) };
                 variantsMemory += sizeof(BuildingVariant) * variant_count;
+
+                // Filled in by build_variant_lookup() once we've read all the variants.
+                s32 lookup_size = BuildingDef::variant_lookup_size(def->isIntersection);
+                def->variantLookup = { static_cast<size_t>(lookup_size), variantLookupsMemory, static_cast<size_t>(lookup_size) };
+                variantLookupsMemory += lookup_size;
             }
 
         }
@@ -345,6 +365,8 @@ ErrorOr<OwnedRef<BuildingDefs>> BuildingDefs::load(AssetMetadata& metadata, Blob
                 // before we had 4 different states per connection, which prevents that.)
                 // So, this makes the order important! If multiple variants can match a
                 // situation, then the more specific one needs to come first.
+                // (That search now happens once per neighbour combination when the def is
+                // loaded, in build_variant_lookup(), but the ordering rule is the same.)
                 //
                 // eg, if you have an "anything in all directions" variant, and it's first,
                 // then nothing else will ever get chosen!
@@ -411,6 +433,7 @@ ErrorOr<OwnedRef<BuildingDefs>> BuildingDefs::load(AssetMetadata& metadata, Blob
 
     if (def != nullptr) {
         // Categorise the last building
+        def->build_variant_lookup();
         assign_building_categories(*catalogue, *def);
     }
 
@@ -30,17 +30,22 @@ City::City(MemoryArena& arena, u32 width, u32 height, String name, String player
     , funds(funds)
     , bounds(0u, 0u, width, height)
     , tileBuildingIndex(arena.allocate_array_2d<s32>(width, height))
+    , tileHasBuilding(arena, width * height)
     , buildings(arena, 1024)
+    , buildingTickData(arena, buildings.itemsPerChunk) // Grows along with `buildings`, in insert_building()
     , sectors(&arena, bounds.size(), 16, 8)
     , entities(arena, 1024)
     , sectorBuildingsChunkPool(arena, 128)
+    , sectorEntitiesChunkPool(arena, 128)
     , sectorBoundariesChunkPool(arena, 8)
     , buildingRefsChunkPool(arena, 128)
+    , m_marked_areas { DirtyRects { arena, bounds }, DirtyRects { arena, bounds } }
 {
 
     for (s32 sectorIndex = 0; sectorIndex < sectors.sector_count(); sectorIndex++) {
         CitySector* sector = sectors.get_by_index(sectorIndex);
         new (&sector->ownedBuildings) ChunkedArray { sectorBuildingsChunkPool };
+        new (&sector->entities) ChunkedArray { sectorEntitiesChunkPool };
     }
 
     (void)buildings.append(); // Null building
@@ -67,6 +72,20 @@ City::City(MemoryArena& arena, u32 width, u32 height, String name, String player
     m_layers.append(&powerLayer);
     m_layers.append(&transportLayer);
 
+    // Layers with the same radius share the expanded area.
+    m_dirty_areas = arena.allocate_array<DirtyAreaForRadius>(m_layers.count());
+    for (auto const* layer : m_layers) {
+        auto radius = layer->dirty_area_radius();
+        if (!radius.has_value())
+            continue;
+
+        bool alreadyRegistered = false;
+        for (auto const& dirtyArea : m_dirty_areas)
+            alreadyRegistered |= (dirtyArea.radius == radius.value());
+        if (!alreadyRegistered)
+            m_dirty_areas.append({ radius.value(), DirtyRects { arena, bounds }, true });
+    }
+
     // TODO: The rest of this code doesn't really belong here!
     // It belongs in a "we've just started/loaded a game, so initialise things" place.
 
@@ -79,74 +98,226 @@ City::City(MemoryArena& arena, u32 width, u32 height, String name, String player
     saveTerrainTypes();
 }
 
+void City::move_entity(Entity* entity, Rect2 bounds)
+{
+    remove_entity_from_owner_sector(*entity);
+    entity->bounds = bounds;
+    add_entity_to_owner_sector(*entity);
+}
+
 void City::remove_entity(Entity* entity)
 {
     // logInfo("Removing entity #{0}"_s, {formatInt(entity->index)});
+    remove_entity_from_owner_sector(*entity);
     entities.removeIndex(entity->index);
 }
 
+CitySector* City::get_entity_owner_sector(Entity const& entity)
+{
+    CitySector* sector = sectors.get_sector_at_tile_pos(floor_s32(entity.bounds.x()), floor_s32(entity.bounds.y()));
+    ASSERT(sector != nullptr); // Entities must be inside the city!
+    return sector;
+}
+
+void City::add_entity_to_owner_sector(Entity& entity)
+{
+    auto& sectorEntities = get_entity_owner_sector(entity)->entities;
+    entity.ownerSectorIndex = sectorEntities.count;
+    sectorEntities.append(&entity);
+
+    m_max_entity_size = max(m_max_entity_size, ceil_s32(max(entity.bounds.width(), entity.bounds.height())));
+}
+
+void City::remove_entity_from_owner_sector(Entity& entity)
+{
+    auto& sectorEntities = get_entity_owner_sector(entity)->entities;
+    s32 index = entity.ownerSectorIndex;
+    ASSERT(sectorEntities.get(index) == &entity);
+
+    // take_index() moves the last entity into our slot, so update its back-reference.
+    s32 lastIndex = sectorEntities.count - 1;
+    if (index != lastIndex)
+        sectorEntities.get(lastIndex)->ownerSectorIndex = index;
+
+    sectorEntities.take_index(index);
+}
+
+// One entity to draw, with the key draw_entities() sorts by: depth in the high 32 bits, then texture.
+struct EntityDrawItem {
+    u64 sortKey;
+    Sprite* sprite;
+    Rect2 bounds;
+    Colour colour;
+};
+
+// Maps a float to a u32 that sorts the same way when compared as unsigned.
+static u32 sortable_float_bits(float value)
+{
+    u32 bits = std::bit_cast<u32>(value);
+    return (bits & 0x8000'0000) ? ~bits : (bits | 0x8000'0000);
+}
+
+// Stable LSD radix sort of `items` by sortKey, 8 bits at a time, using `scratch` as the other buffer.
+// Passes where every item has the same digit are skipped, which is most of them in practice.
+// Returns whichever of the two buffers ends up holding the sorted items.
+static Span<EntityDrawItem> radix_sort_draw_items(Span<EntityDrawItem> items, Span<EntityDrawItem> scratch)
+{
+    DEBUG_FUNCTION();
+
+    s32 constexpr digitCount = sizeof(u64);
+    s32 counts[digitCount][256] {};
+    for (auto const& item : items) {
+        for (s32 digit = 0; digit < digitCount; digit++)
+            counts[digit][(item.sortKey >> (digit * 8)) & 0xFF]++;
+    }
+
+    Span<EntityDrawItem> source = items;
+    Span<EntityDrawItem> destination = scratch;
+    for (s32 digit = 0; digit < digitCount; digit++) {
+        auto& digitCounts = counts[digit];
+        if (digitCounts[(source.first().sortKey >> (digit * 8)) & 0xFF] == static_cast<s32>(source.size()))
+            continue;
+
+        s32 offsets[256];
+        s32 total = 0;
+        for (s32 bucket = 0; bucket < 256; bucket++) {
+            offsets[bucket] = total;
+            total += digitCounts[bucket];
+        }
+
+        for (auto const& item : source)
+            destination[offsets[(item.sortKey >> (digit * 8)) & 0xFF]++] = item;
+
+        std::swap(source, destination);
+    }
+
+    return source;
+}
+
 void City::draw_entities(Rect2I visibleTileBounds) const
 {
-    // TODO: Depth sorting
-    // TODO: Sectors maybe? Though collecting all the visible entities into a data structure might be slower than just
-    //  iterating the entities array.
+    DEBUG_FUNCTION();
+
     Rect2 cropArea = visibleTileBounds;
     auto shaderID = the_renderer().shaderIds.pixelArt;
 
     bool isDemolitionHappening = demolitionRect.has_positive_area();
     auto drawColorDemolish = Colour::from_rgb_255(255, 128, 128, 255);
 
-    for (auto it = entities.iterate(); it.hasNext(); it.next()) {
-        auto entity = it.get();
-        if (cropArea.overlaps(entity->bounds)) {
-            // TODO: Batch these together somehow? Our batching is a bit complicated.
-            // OK, turns out our renderer still batches same-texture-same-shader calls into a single draw call!
-            // So, the difference is just sending N x RenderItem_DrawSingleRect instead of 1 x RenderItem_DrawRects
-            // Thanks, past me!
-            // - Sam, 26/09/2020
+    // Entities live in the sector containing their top-left corner, so look up and left by the largest
+    // entity size to catch ones that poke into the area from a neighbouring sector.
+    Rect2I sectorsArea = sectors.get_sectors_covered(visibleTileBounds.expanded(m_max_entity_size, 0, 0, m_max_entity_size));
+    Rect2I demolitionSectorsArea = isDemolitionHappening
+        ? sectors.get_sectors_covered(demolitionRect.expanded(m_max_entity_size, 0, 0, m_max_entity_size))
+        : Rect2I {};
+
+    s32 maxItemCount = 0;
+    for (s32 sY = sectorsArea.y(); sY < sectorsArea.y() + sectorsArea.height(); sY++) {
+        for (s32 sX = sectorsArea.x(); sX < sectorsArea.x() + sectorsArea.width(); sX++)
+            maxItemCount += sectors.get(sX, sY)->entities.count;
+    }
+    if (maxItemCount == 0)
+        return;
+
+    // Collect the visible entities into a draw list, so we can sort them by depth and then by texture.
+    // That way things overlap correctly, and we only switch textures when we have to.
+    Array<EntityDrawItem> drawItems = temp_arena().allocate_array<EntityDrawItem>(maxItemCount);
+    // Textures get numbered in the order we first see them. There are only ever a handful.
+    Array<AssetMetadata*> textures = temp_arena().allocate_array<AssetMetadata*>(maxItemCount);
 
-            auto drawColor = entity->color;
+    for (s32 sY = sectorsArea.y(); sY < sectorsArea.y() + sectorsArea.height(); sY++) {
+        for (s32 sX = sectorsArea.x(); sX < sectorsArea.x() + sectorsArea.width(); sX++) {
+            auto const* sector = sectors.get(sX, sY);
+            bool sectorCouldBeDemolished = demolitionSectorsArea.contains(sX, sY);
 
-            if (entity->canBeDemolished && isDemolitionHappening && entity->bounds.overlaps(demolitionRect)) {
-                drawColor = drawColor.multiplied_by(drawColorDemolish);
-            }
+            for (auto it = sector->entities.iterate(0, false); it.hasNext(); it.next()) {
+                Entity* entity = it.getValue();
+                if (!cropArea.overlaps(entity->bounds))
+                    continue;
+
+                auto drawColor = entity->color;
 
-            drawSingleSprite(&the_renderer().world_buffer(), &entity->sprite.get(), entity->bounds, shaderID, drawColor);
+                if (sectorCouldBeDemolished && entity->canBeDemolished && entity->bounds.overlaps(demolitionRect)) {
+                    drawColor = drawColor.multiplied_by(drawColorDemolish);
+                }
+
+                Sprite* sprite = &entity->sprite.get();
+                u32 textureIndex = 0;
+                while (textureIndex < textures.count() && textures[textureIndex] != sprite->texture)
+                    textureIndex++;
+                if (textureIndex == textures.count())
+                    textures.append(sprite->texture);
+
+                drawItems.append({
+                    .sortKey = (static_cast<u64>(sortable_float_bits(entity->depth)) << 32) | textureIndex,
+                    .sprite = sprite,
+                    .bounds = entity->bounds,
+                    .colour = drawColor,
+                });
+            }
         }
     }
+
+    if (drawItems.is_empty())
+        return;
+
+    Array<EntityDrawItem> scratch = temp_arena().allocate_array<EntityDrawItem>(drawItems.count());
+    scratch.set_count(drawItems.count());
+    auto sortedItems = radix_sort_draw_items(drawItems, scratch);
+
+    // Send each run of same-texture items as one group.
+    for (size_t runStart = 0; runStart < sortedItems.size();) {
+        AssetMetadata* texture = sortedItems[runStart].sprite->texture;
+        size_t runEnd = runStart + 1;
+        while (runEnd < sortedItems.size() && sortedItems[runEnd].sprite->texture == texture)
+            runEnd++;
+
+        DrawRectsGroup* group = beginRectsGroupTextured(&the_renderer().world_buffer(), texture, shaderID, truncate32(runEnd - runStart));
+        for (size_t i = runStart; i < runEnd; i++)
+            addSpriteRect(group, sortedItems[i].sprite, sortedItems[i].bounds, sortedItems[i].colour);
+        endRectsGroup(group);
+
+        runStart = runEnd;
+    }
 }
 
 Building* City::add_building_direct(s32 id, BuildingDef* def, Rect2I footprint, GameTimestamp creationDate)
 {
     DEBUG_FUNCTION();
 
+    // Random sprite!
+    Building* building = insert_building(id, def, footprint, creationDate, App::the().cosmetic_random().random_integer<u16>());
+
+    for (auto const& layer : m_layers)
+        layer->notify_new_building(*def, *building);
+
+    return building;
+}
+
+Building* City::insert_building(s32 id, BuildingDef* def, Rect2I footprint, GameTimestamp creationDate, u16 spriteOffset, Optional<s16> variantIndex)
+{
+    DEBUG_FUNCTION();
+
     // FIXME: This is weird, we should construct in one go.
     auto [building_index, building] = buildings.empend(id, *def, footprint, creationDate);
+    building.index = building_index;
+    building.spriteOffset = spriteOffset;
+    building.variantIndex = variantIndex;
+    buildingTickData.ensure_capacity(buildings.chunkCount * buildings.itemsPerChunk);
+    buildingTickData.add(building_index, def->typeID, footprint);
 
-    // Random sprite!
-    building.spriteOffset = App::the().cosmetic_random().random_integer<u16>();
-
-    building.entity = add_entity(Entity::Type::Building, &building);
-    building.entity->bounds = footprint;
+    building.entity = add_entity(Entity::Type::Building, &building, footprint);
     building.load_sprite();
     building.entity->canBeDemolished = true;
 
     CitySector* ownerSector = sectors.get_sector_at_tile_pos(footprint.x(), footprint.y());
 
+    building.ownerSectorIndex = ownerSector->ownedBuildings.count;
     ownerSector->ownedBuildings.append(&building);
 
-    for (s32 y = footprint.y();
-        y < footprint.y() + footprint.height();
-        y++) {
-        for (s32 x = footprint.x();
-            x < footprint.x() + footprint.width();
-            x++) {
-            tileBuildingIndex.set(x, y, building_index);
-        }
-    }
-
-    for (auto const& layer : m_layers)
-        layer->notify_new_building(*def, building);
+    tileBuildingIndex.fill_region(footprint, building_index);
+    for (s32 y = footprint.y(); y < footprint.y() + footprint.height(); y++)
+        tileHasBuilding.set_range((y * bounds.width()) + footprint.x(), footprint.width());
 
     return &building;
 }
@@ -166,8 +337,25 @@ Building* City::add_building(BuildingDef* def, Rect2I footprint, Optional<GameTi
 
 void City::mark_area_dirty(Rect2I dirty_area)
 {
-    for (auto& layer : m_layers)
-        layer->mark_dirty(dirty_area);
+    m_marked_areas[m_marking_index].mark_dirty(dirty_area);
+}
+
+DirtyRects const& City::dirty_area(s32 radius)
+{
+    for (auto& dirtyArea : m_dirty_areas) {
+        if (dirtyArea.radius != radius)
+            continue;
+
+        if (!dirtyArea.isCurrent) {
+            DEBUG_BLOCK_T("City::dirty_area: expand", DebugCodeDataTag::Simulation);
+            for (auto it = changed_area().rects().iterate(); it.hasNext(); it.next())
+                dirtyArea.area.mark_dirty(it.getValue().expanded(radius));
+            dirtyArea.isCurrent = true;
+        }
+        return dirtyArea.area;
+    }
+
+    VERIFY_NOT_REACHED();
 }
 
 bool City::tile_exists(s32 x, s32 y) const
@@ -204,19 +392,19 @@ bool City::can_place_building(BuildingDef* def, s32 left, s32 top) const
 
     auto& catalogue = BuildingCatalogue::the();
 
-    // Check terrain is buildable and empty
-    // TODO: Optimise this per-sector!
+    // Check terrain is buildable and empty, up to 64 tiles of each row at a time
     for (s32 y = footprint.y(); y < footprint.y() + footprint.height(); y++) {
-        for (s32 x = footprint.x(); x < footprint.x() + footprint.width(); x++) {
-            auto& terrain_def = terrainLayer.terrain_at(x, y);
+        for (s32 x = footprint.x(); x < footprint.x() + footprint.width(); x += 64) {
+            s32 count = min(64, footprint.x() + footprint.width() - x);
 
-            if (!terrain_def.canBuildOn)
+            if (terrainLayer.buildable_tiles_in_row(x, y, count) != low_bits_mask(count))
                 return false;
 
-            auto* buildingAtPos = get_building_at(x, y);
-            if (buildingAtPos != nullptr) {
+            for (u64 occupied = occupied_tiles_in_row(x, y, count); occupied != 0; occupied &= occupied - 1) {
+                auto& buildingAtPos = *get_building_at(x + count_trailing_zeros(occupied), y);
+
                 // Check if we can combine this with the building that's already there
-                if (catalogue.find_building_intersection(buildingAtPos->get_def(), *def).has_value()) {
+                if (catalogue.find_building_intersection(buildingAtPos.get_def(), *def).has_value()) {
                     // We can!
                     // TODO: We want to check if there is a valid variant, before we build.
                     // But that means matching against buildings that aren't constructed yet,
@@ -245,7 +433,7 @@ void City::place_building(BuildingDef* def, s32 left, s32 top, bool markAreasDir
         auto& old_def = building->get_def();
         auto& intersection_def = BuildingCatalogue::the().find_building_intersection(old_def, *def).release_value();
 
-        building->typeID = intersection_def.typeID;
+        building->set_type(intersection_def.typeID, *this);
         def = const_cast<BuildingDef*>(&intersection_def); // I really don't like this but I don't want to rewrite this entire function right now!
 
         zoneLayer.population[old_def.growsInZone] -= building->currentResidents + building->currentJobs;
@@ -291,14 +479,64 @@ void City::place_building_rect(BuildingDef* def, Rect2I area)
 {
     DEBUG_FUNCTION();
 
+    // This is place_building() for a whole drag at once. We insert all the buildings first, and then
+    // notify the layers, update variants and mark things dirty once for the whole area, instead of
+    // once per building.
+    s32 maxBuildingCount = (area.width() / def->size.x) * (area.height() / def->size.y);
+    Array<Building*> newBuildings = temp_arena().allocate_array<Building*>(maxBuildingCount);
+    GameTimestamp creationDate = gameClock.current_day();
+
     for (s32 y = 0; y + def->size.y <= area.height(); y += def->size.y) {
         for (s32 x = 0; x + def->size.x <= area.width(); x += def->size.x) {
-            if (can_place_building(def, area.x() + x, area.y() + y)) {
-                place_building(def, area.x() + x, area.y() + y, false);
+            s32 left = area.x() + x;
+            s32 top = area.y() + y;
+            if (!can_place_building(def, left, top))
+                continue;
+
+            if (Building* building = get_building_at(left, top)) {
+                // Do a quick replace, the same as place_building() does.
+                auto& old_def = building->get_def();
+                auto& intersection_def = BuildingCatalogue::the().find_building_intersection(old_def, *def).release_value();
+
+                building->set_type(intersection_def.typeID, *this);
+                // The variant pass below skips defs without variants, so the sprite has to change here.
+                // For defs with variants, the neighbours aren't all placed yet, but that pass fixes it up.
+                building->update_variant(*this, intersection_def);
+
+                zoneLayer.population[old_def.growsInZone] -= building->currentResidents + building->currentJobs;
+                building->currentResidents = intersection_def.residents;
+                building->currentJobs = intersection_def.jobs;
+                zoneLayer.population[intersection_def.growsInZone] += building->currentResidents + building->currentJobs;
+                continue;
             }
+
+            Rect2I footprint { { left, top }, def->size };
+
+            // Remove zones. We know the footprint is empty, so we can skip what placeZone() checks.
+            zoneLayer.tileZone.fill_region(footprint, ZoneType::None);
+            zoneLayer.unsavedSectors.mark_changed(footprint);
+
+            Building* building = insert_building(++highestBuildingID, def, footprint, creationDate, App::the().cosmetic_random().random_integer<u16>());
+
+            // TODO: Calculate residents/jobs properly!
+            building->currentResidents = def->residents;
+            building->currentJobs = def->jobs;
+            zoneLayer.population[def->growsInZone] += building->currentResidents + building->currentJobs;
+
+            newBuildings.append(building);
         }
     }
 
+    for (auto& layer : m_layers)
+        layer->notify_new_buildings(newBuildings);
+
+    // Anything in or next to the area might have gained a new neighbour, so update their variants.
+    visit_buildings_overlapping_area(area, {}, [this](Building& building) {
+        if (building.get_def().variants.count() > 0)
+            building.update_variant(*this, {});
+    });
+    update_adjacent_building_variants(area);
+
     mark_area_dirty(area);
 }
 
@@ -323,77 +561,55 @@ void City::demolish_rect(Rect2I area)
     // NB: We assume that we've already checked we can afford this!
 
     // Building demolition
-    // FIXME: We first accumulate the buildings into an array to make removal safe. Find some way to avoid this?
-    ChunkedArray<Building*> buildingsToDemolish { temp_arena(), 1024 };
-    for_each_building_overlapping_area(area, {}, [&](Building& building) {
-        buildingsToDemolish.append(&building);
-    });
-    for (auto it = buildingsToDemolish.iterate(buildingsToDemolish.count - 1, false, true);
-        it.hasNext();
-        it.next()) {
-        Building* building = it.getValue();
-        auto& def = building->get_def();
-
-        zoneLayer.population[def.growsInZone] -= building->currentResidents + building->currentJobs;
+    Rect2I sectorsArea = sectors_covered_by_building_query(area, {});
+    for (s32 sY = sectorsArea.y();
+        sY < sectorsArea.y() + sectorsArea.height();
+        sY++) {
+        for (s32 sX = sectorsArea.x();
+            sX < sectorsArea.x() + sectorsArea.width();
+            sX++) {
+            auto& ownedBuildings = sectors.get(sX, sY)->ownedBuildings;
 
-        Rect2I buildingFootprint = building->footprint;
+            // Go backwards, so that swap-removing a building only moves one we've already checked into its slot.
+            for (s32 i = ownedBuildings.count - 1; i >= 0; i--) {
+                Building* building = ownedBuildings.get(i);
+                if (!building->footprint.overlaps(area))
+                    continue;
 
-        // Clean up other references
-        for (auto& layer : m_layers)
-            layer->notify_building_demolished(def, *building);
+                auto& def = building->get_def();
 
-        building->id = 0;
+                zoneLayer.population[def.growsInZone] -= building->currentResidents + building->currentJobs;
 
-        s32 buildingIndex = tileBuildingIndex.get(buildingFootprint.x(), buildingFootprint.y());
-        buildings.removeIndex(buildingIndex);
-        remove_entity(building->entity);
+                Rect2I buildingFootprint = building->footprint;
 
-        building = nullptr; // For safety, because we just deleted the Building!
+                // Clean up other references
+                for (auto& layer : m_layers)
+                    layer->notify_building_demolished(def, *building);
 
-        for (s32 y = buildingFootprint.y();
-            y < buildingFootprint.y() + buildingFootprint.height();
-            y++) {
-            for (s32 x = buildingFootprint.x();
-                x < buildingFootprint.x() + buildingFootprint.width();
-                x++) {
-                tileBuildingIndex.set(x, y, 0);
-            }
-        }
+                remove_building_from_owner_sector(*building);
+                building->id = 0;
 
-        // Only need to add the footprint as a separate rect if it's not inside the area!
-        if (!area.contains(buildingFootprint)) {
-            mark_area_dirty(buildingFootprint);
-        }
-    }
+                s32 buildingIndex = building->index;
+                buildings.removeIndex(buildingIndex);
+                buildingTickData.remove(buildingIndex);
+                remove_entity(building->entity);
 
-    // Expand the area to account for buildings to the left or up from it
-    auto& building_catalogue = BuildingCatalogue::the();
-    Rect2I expandedArea = area.expanded(building_catalogue.overallMaxBuildingDim, 0, 0, building_catalogue.overallMaxBuildingDim);
-    Rect2I sectorsArea = sectors.get_sectors_covered(expandedArea);
+                building = nullptr; // For safety, because we just deleted the Building!
 
-    for (s32 sY = sectorsArea.y();
-        sY < sectorsArea.y() + sectorsArea.height();
-        sY++) {
-        for (s32 sX = sectorsArea.x();
-            sX < sectorsArea.x() + sectorsArea.width();
-            sX++) {
-            CitySector* sector = sectors.get(sX, sY);
-
-            // Rebuild the ownedBuildings array
-            sector->ownedBuildings.clear();
-
-            for (s32 y = sector->bounds.y();
-                y < sector->bounds.y() + sector->bounds.height();
-                y++) {
-                for (s32 x = sector->bounds.x();
-                    x < sector->bounds.x() + sector->bounds.width();
-                    x++) {
-                    Building* b = get_building_at(x, y);
-                    if (b != nullptr) {
-                        if (b->footprint.x() == x && b->footprint.y() == y) {
-                            sector->ownedBuildings.append(b);
-                        }
+                for (s32 y = buildingFootprint.y();
+                    y < buildingFootprint.y() + buildingFootprint.height();
+                    y++) {
+                    for (s32 x = buildingFootprint.x();
+                        x < buildingFootprint.x() + buildingFootprint.width();
+                        x++) {
+                        tileBuildingIndex.set(x, y, 0);
                     }
+                    tileHasBuilding.unset_range((y * bounds.width()) + buildingFootprint.x(), buildingFootprint.width());
+                }
+
+                // Only need to add the footprint as a separate rect if it's not inside the area!
+                if (!area.contains(buildingFootprint)) {
+                    mark_area_dirty(buildingFootprint);
                 }
             }
         }
@@ -410,34 +626,37 @@ void City::for_each_building_overlapping_area(Rect2I area, Flags<BuildingQueryFl
 {
     DEBUG_FUNCTION();
 
-    // Expand the area to account for buildings to the left or up from it
-    // (but don't do that if we only care about origins)
-    s32 expansion = flags.has(BuildingQueryFlag::RequireOriginInArea) ? 0 : BuildingCatalogue::the().overallMaxBuildingDim;
-    Rect2I expandedArea = area.expanded(expansion, 0, 0, expansion);
-    Rect2I sectorsArea = sectors.get_sectors_covered(expandedArea);
+    visit_buildings_overlapping_area(area, flags, callback);
+}
 
-    for (s32 sY = sectorsArea.y();
-        sY < sectorsArea.y() + sectorsArea.height();
-        sY++) {
-        for (s32 sX = sectorsArea.x();
-            sX < sectorsArea.x() + sectorsArea.width();
-            sX++) {
-            auto* sector = sectors.get(sX, sY);
+void City::for_each_building_overlapping_area(Rect2I area, Flags<BuildingQueryFlag> flags, Function<void(Building const&)> const& callback) const
+{
+    DEBUG_FUNCTION();
 
-            for (auto it = sector->ownedBuildings.iterate(); it.hasNext(); it.next()) {
-                Building* building = it.getValue();
-                if (building->footprint.overlaps(area))
-                    callback(*building);
-            }
-        }
-    }
+    visit_buildings_overlapping_area(area, flags, callback);
 }
 
-void City::for_each_building_overlapping_area(Rect2I area, Flags<BuildingQueryFlag> flags, Function<void(Building const&)> const& callback) const
+void City::remove_building_from_owner_sector(Building& building)
 {
-    const_cast<City*>(this)->for_each_building_overlapping_area(area, flags, [&callback](auto const& building) {
-        callback(const_cast<Building&>(building));
-    });
+    auto& ownedBuildings = sectors.get_sector_at_tile_pos(building.footprint.x(), building.footprint.y())->ownedBuildings;
+    s32 index = building.ownerSectorIndex;
+    ASSERT(ownedBuildings.get(index) == &building);
+
+    // take_index() moves the last building into our slot, so update its back-reference.
+    s32 lastIndex = ownedBuildings.count - 1;
+    if (index != lastIndex)
+        ownedBuildings.get(lastIndex)->ownerSectorIndex = index;
+
+    ownedBuildings.take_index(index);
+}
+
+Rect2I City::sectors_covered_by_building_query(Rect2I area, Flags<BuildingQueryFlag> flags) const
+{
+    // Expand the area to account for buildings to the left or up from it
+    // (but don't do that if we only care about origins)
+    s32 expansion = flags.has(BuildingQueryFlag::RequireOriginInArea) ? 0 : BuildingCatalogue::the().overallMaxBuildingDim;
+    Rect2I expandedArea = area.expanded(expansion, 0, 0, expansion);
+    return sectors.get_sectors_covered(expandedArea);
 }
 
 void City::draw(Rect2I visible_tile_bounds) const
@@ -476,6 +695,12 @@ bool City::building_exists_at(s32 x, s32 y) const
     return tileBuildingIndex.get(x, y) > 0;
 }
 
+u64 City::occupied_tiles_in_row(s32 x, s32 y, s32 count) const
+{
+    ASSERT(bounds.contains(Rect2I { x, y, count, 1 }));
+    return tileHasBuilding.get_bits((y * bounds.width()) + x, count);
+}
+
 Building* City::get_building_at(s32 x, s32 y)
 {
     Building* result = nullptr;
@@ -494,16 +719,101 @@ void City::update()
 {
     zoneLayer.update(*this);
 
+    // The layers all see the areas marked dirty up to this point. Anything marked during the update is kept for next time.
+    m_marking_index = 1 - m_marking_index;
+    m_marked_areas[m_marking_index].clear();
+    for (auto& dirtyArea : m_dirty_areas) {
+        dirtyArea.area.clear();
+        dirtyArea.isCurrent = !changed_area().is_dirty();
+    }
+
     for (auto& layer : m_layers)
         layer->update(*this);
 
-    // Runs an update on X sectors' buildings, gradually covering the whole city with subsequent calls.
-    for (s32 i = 0; i < sectors.sectors_to_update_per_tick(); i++) {
-        auto [_, sector] = sectors.get_next_sector();
+    // Runs an update on a slice of the buildings, gradually covering the whole city with subsequent calls.
+    // This goes in building index order rather than by sector, so that it streams through buildingTickData.
+    // We cover the same fraction of the buildings each tick as we would by updating X sectors.
+    s32 slotCount = min(buildingTickData.capacity(), buildings.chunkCount * buildings.itemsPerChunk);
+    s32 slotsToUpdate = divideCeil(slotCount * sectors.sectors_to_update_per_tick(), sectors.sector_count());
+    for (s32 i = 0; i < slotsToUpdate; i++) {
+        s32 buildingIndex = m_next_building_update_index;
+        m_next_building_update_index = (m_next_building_update_index + 1) % slotCount;
+
+        // Skip empty slots. (This also skips buildings whose type is missing, but they have nothing to update.)
+        if (buildingTickData.typeID[buildingIndex] != 0)
+            update_building(buildingIndex);
+    }
+}
 
-        for (auto it = sector.ownedBuildings.iterate(); it.hasNext(); it.next()) {
-            Building* building = it.getValue();
-            building->update(*this);
+void City::update_building(s32 buildingIndex)
+{
+    auto& def = *getBuildingDef(buildingTickData.typeID[buildingIndex]);
+    Rect2I footprint = buildingTickData.footprint[buildingIndex];
+    auto oldProblems = buildingTickData.problems[buildingIndex];
+    auto problems = oldProblems;
+
+    // Check the building's needs are met
+    // ... except for the ones that are checked by layers.
+
+    // Distance to road
+    // TODO: Replace with access to any transport types, instead of just road? Not sure what we want with that.
+    if ((def.flags.has(BuildingFlags::RequiresTransportConnection)) || (def.growsInZone != ZoneType::None)) {
+        s32 distanceToRoad = s32Max;
+        // TODO: @Speed: We only actually need to check the boundary tiles, because they're guaranteed to be less than
+        // the inner tiles... unless we allow multiple buildings per tile. Actually maybe we do? I'm not sure how that
+        // would work really. Anyway, can think about that later.
+        // - Sam, 30/08/2019
+        for (s32 y = footprint.y(); y < footprint.y() + footprint.height(); y++) {
+            for (s32 x = footprint.x(); x < footprint.x() + footprint.width(); x++) {
+                distanceToRoad = min(distanceToRoad, transportLayer.distance_to_transport(x, y, TransportType::Road));
+            }
+        }
+
+        if (def.growsInZone != ZoneType::None) {
+            // Zoned buildings inherit their zone's max distance to road.
+            if (distanceToRoad > ZONE_DEFS[def.growsInZone].maximumDistanceToRoad) {
+                problems.add(BuildingProblem::Type::NoTransportAccess);
+            } else {
+                problems.remove(BuildingProblem::Type::NoTransportAccess);
+            }
+        } else if (def.flags.has(BuildingFlags::RequiresTransportConnection)) {
+            // Other buildings require direct contact
+            if (distanceToRoad > 1) {
+                problems.add(BuildingProblem::Type::NoTransportAccess);
+            } else {
+                problems.remove(BuildingProblem::Type::NoTransportAccess);
+            }
+        }
+    }
+
+    // Fire!
+    if (fireLayer.does_area_contain_fire(footprint)) {
+        problems.add(BuildingProblem::Type::Fire);
+    } else {
+        problems.remove(BuildingProblem::Type::Fire);
+    }
+
+    // Power!
+    if (def.power < 0) {
+        if (-def.power > buildingTickData.allocatedPower[buildingIndex]) {
+            problems.add(BuildingProblem::Type::NoPower);
+        } else {
+            problems.remove(BuildingProblem::Type::NoPower);
+        }
+    }
+
+    // Only go to the Building itself if something changed.
+    if (problems != oldProblems) {
+        Building* building = buildings.get(buildingIndex);
+        for (auto problem_type : enum_values<BuildingProblem::Type>()) {
+            if (problems.has(problem_type) == oldProblems.has(problem_type))
+                continue;
+
+            if (problems.has(problem_type)) {
+                building->add_problem(problem_type, *this);
+            } else {
+                building->remove_problem(problem_type, *this);
+            }
         }
     }
 }
@@ -573,11 +883,19 @@ void City::save_buildings(BinaryFileWriter* writer) const
 
         tempBuildingIndex++;
     }
-    buildingSection.buildings = writer->appendBlob(buildingSection.buildingCount * sizeof(SAVBuilding), (u8*)tempBuildings.raw_data(), FileBlobCompressionScheme::Uncompressed);
+    writer->appendBlob(&buildingSection.buildings, buildingSection.buildingCount * sizeof(SAVBuilding), (u8*)tempBuildings.raw_data(), FileBlobCompressionScheme::Smallest, { .transposeStride = sizeof(SAVBuilding) });
 
     writer->endSection<SAVSection_Buildings>(&buildingSection);
 }
 
+void City::clear_unsaved_sectors()
+{
+    terrainLayer.clear_unsaved_sectors();
+    zoneLayer.unsavedSectors.clear();
+    for (auto& layer : m_layers)
+        layer->clear_unsaved_sectors();
+}
+
 bool City::load_buildings(BinaryFileReader* reader)
 {
     bool succeeded = reader->startSection(SAV_BUILDING_ID, SAV_BUILDING_VERSION);
@@ -591,10 +909,10 @@ bool City::load_buildings(BinaryFileReader* reader)
         // Map the file's building type IDs to the game's ones
         // NB: count+1 because the file won't save the null building, so we need to compensate
         Array<u32> oldTypeToNewType = reader->arena->allocate_filled_array<u32>(section->buildingTypeTable.count + 1);
-        Array<SAVBuildingTypeEntry> buildingTypeTable = reader->arena->allocate_array<SAVBuildingTypeEntry>(section->buildingTypeTable.count);
-        if (!reader->readArray(section->buildingTypeTable, &buildingTypeTable))
+        auto buildingTypeTable = reader->readArray<SAVBuildingTypeEntry>(section->buildingTypeTable);
+        if (!buildingTypeTable.has_value())
             break;
-        for (auto const& entry : buildingTypeTable) {
+        for (auto const& entry : buildingTypeTable.value()) {
             String buildingName = reader->readString(entry.name);
 
             BuildingDef* def = findBuildingDef(buildingName);
@@ -629,6 +947,14 @@ bool City::load_buildings(BinaryFileReader* reader)
         Array<SAVBuilding> tempBuildings = reader->arena->allocate_array<SAVBuilding>(section->buildingCount);
         if (!reader->readBlob(section->buildings, &tempBuildings))
             break;
+
+        // Like place_building_rect(), we insert everything first, and then tell the layers about all
+        // the buildings at once. Reserving up front means the arrays don't grow one chunk at a time.
+        buildings.reserve(section->buildingCount);
+        entities.reserve(section->buildingCount);
+        buildingTickData.ensure_capacity(buildings.chunkCount * buildings.itemsPerChunk);
+        Array<Building*> loadedBuildings = reader->arena->allocate_array<Building*>(section->buildingCount);
+
         for (u32 buildingIndex = 0;
             buildingIndex < section->buildingCount;
             buildingIndex++) {
@@ -636,21 +962,20 @@ bool City::load_buildings(BinaryFileReader* reader)
 
             Rect2I footprint { savBuilding->x, savBuilding->y, savBuilding->w, savBuilding->h };
             BuildingDef* def = getBuildingDef(oldTypeToNewType[savBuilding->typeID]);
-            Building* building = add_building_direct(savBuilding->id, def, footprint, savBuilding->creationDate);
-            building->variantIndex = savBuilding->variantIndex == -1 ? Optional<s16> {} : Optional<s16> { savBuilding->variantIndex.value() };
-            building->spriteOffset = savBuilding->spriteOffset;
+            Optional<s16> variantIndex = savBuilding->variantIndex == -1 ? Optional<s16> {} : Optional<s16> { savBuilding->variantIndex.value() };
+            Building* building = insert_building(savBuilding->id, def, footprint, savBuilding->creationDate, savBuilding->spriteOffset, variantIndex);
             building->currentResidents = savBuilding->currentResidents;
             building->currentJobs = savBuilding->currentJobs;
-            // Because the sprite was assigned in addBuildingDirect(), before we loaded the variant, we
-            // need to overwrite the sprite here.
-            // Probably there's a better way to organise this, but this works.
-            // - Sam, 26/09/2020
-            building->load_sprite();
 
             // This is a bit hacky but it's how we calculate it elsewhere
             zoneLayer.population[def->growsInZone] += building->currentResidents + building->currentJobs;
+
+            loadedBuildings.append(building);
         }
 
+        for (auto& layer : m_layers)
+            layer->notify_new_buildings(loadedBuildings);
+
         break;
     }
 
@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <Sim/Building.h>
 #include <Sim/Crime.h>
+#include <Sim/DirtyRects.h>
 #include <Sim/Education.h>
 #include <Sim/Entity.h>
 #include <Sim/Fire.h>
@@ -25,6 +27,9 @@
 struct CitySector : public BasicSector {
     // NB: A building is owned by a CitySector if its top-left corner tile is inside that CitySector.
     ChunkedArray<Building*> ownedBuildings;
+
+    // Same for entities, by the top-left corner of their bounds.
+    ChunkedArray<Entity*> entities;
 };
 
 enum class BuildingQueryFlag : u8 {
@@ -32,6 +37,101 @@ enum class BuildingQueryFlag : u8 {
     COUNT,
 };
 
+// Range over the buildings overlapping an area, for use in a range-based for loop. Get one from
+// City::buildings_overlapping_area(). Buildings must not be added or removed while iterating.
+class BuildingsOverlappingArea {
+public:
+    BuildingsOverlappingArea(SectorGrid<CitySector>& sectors, Rect2I area, Rect2I sectors_area)
+        : m_sectors(sectors)
+        , m_area(area)
+        , m_sectors_area(sectors_area)
+    {
+    }
+
+    class Iterator {
+    public:
+        Iterator(BuildingsOverlappingArea const& range, bool is_end)
+            : m_range(range)
+            , m_sector_x(range.m_sectors_area.x())
+            , m_sector_y(range.m_sectors_area.y())
+            , m_is_done(is_end || !range.m_sectors_area.has_positive_area())
+        {
+            if (!m_is_done) {
+                start_sector();
+                skip_to_next_match();
+            }
+        }
+
+        Building& operator*() { return *m_buildings.getValue(); }
+        Building* operator->() { return m_buildings.getValue(); }
+
+        Iterator& operator++()
+        {
+            m_buildings.next();
+            skip_to_next_match();
+            return *this;
+        }
+
+        bool operator==(Iterator const& other) const
+        {
+            if (m_is_done || other.m_is_done)
+                return m_is_done == other.m_is_done;
+
+            return m_sector_x == other.m_sector_x
+                && m_sector_y == other.m_sector_y
+                && m_buildings.getIndex() == other.m_buildings.getIndex();
+        }
+
+    private:
+        void start_sector()
+        {
+            auto& sector = *m_range.m_sectors.get(m_sector_x, m_sector_y);
+            m_buildings = sector.ownedBuildings.iterate(0, false);
+            // If the sector is entirely inside the area, then so are the origins of all its buildings.
+            m_sector_is_inside_area = m_range.m_area.contains(sector.bounds);
+        }
+
+        void skip_to_next_match()
+        {
+            while (!m_is_done) {
+                if (m_buildings.hasNext()) {
+                    if (m_sector_is_inside_area || m_buildings.getValue()->footprint.overlaps(m_range.m_area))
+                        return;
+                    m_buildings.next();
+                    continue;
+                }
+
+                // Move on to the next sector
+                m_sector_x++;
+                if (m_sector_x >= m_range.m_sectors_area.x() + m_range.m_sectors_area.width()) {
+                    m_sector_x = m_range.m_sectors_area.x();
+                    m_sector_y++;
+                    if (m_sector_y >= m_range.m_sectors_area.y() + m_range.m_sectors_area.height()) {
+                        m_is_done = true;
+                        return;
+                    }
+                }
+                start_sector();
+            }
+        }
+
+        BuildingsOverlappingArea const& m_range;
+        s32 m_sector_x;
+        s32 m_sector_y;
+        ChunkedArrayIterator<Building*> m_buildings {};
+        bool m_sector_is_inside_area { false };
+        bool m_is_done;
+    };
+
+    Iterator begin() const { return Iterator(*this, false); }
+    Iterator end() const { return Iterator(*this, true); }
+
+private:
+    SectorGrid<CitySector>& m_sectors;
+    Rect2I m_area;
+    Rect2I m_sectors_area;
+};
+
 struct City {
     static OwnedRef<City> create(MemoryArena&, u32 width, u32 height, String name, String player_name, s32 funds, GameTimestamp date = 0, float time_of_day = 0.0f);
 
@@ -44,10 +144,15 @@ struct City {
     void draw(Rect2I visible_tile_bounds) const;
 
     void mark_area_dirty(Rect2I);
+    // The area marked dirty before this update started, expanded by `radius` and clipped to the city.
+    // `radius` must be one that a layer returns from dirty_area_radius(). Each radius is only built once per update.
+    DirtyRects const& dirty_area(s32 radius);
 
     bool tile_exists(s32 x, s32 y) const;
 
     bool building_exists_at(s32 x, s32 y) const;
+    // Bitmask of whether each of the `count` (max 64) tiles starting at (x,y) and going right has a building.
+    u64 occupied_tiles_in_row(s32 x, s32 y, s32 count) const;
     Building* get_building_at(s32 x, s32 y);
     Building const* get_building_at(s32 x, s32 y) const
     {
@@ -57,6 +162,58 @@ struct City {
     void for_each_building_overlapping_area(Rect2I area, Flags<BuildingQueryFlag> flags, Function<void(Building&)> const&);
     void for_each_building_overlapping_area(Rect2I area, Flags<BuildingQueryFlag> flags, Function<void(Building const&)> const&) const;
 
+    // Same as for_each_building_overlapping_area(), but the callback can be inlined. Use this in hot code.
+    template<typename Callback>
+    void visit_buildings_overlapping_area(Rect2I area, Flags<BuildingQueryFlag> flags, Callback&& callback)
+    {
+        Rect2I sectorsArea = sectors_covered_by_building_query(area, flags);
+
+        for (s32 sY = sectorsArea.y(); sY < sectorsArea.y() + sectorsArea.height(); sY++) {
+            for (s32 sX = sectorsArea.x(); sX < sectorsArea.x() + sectorsArea.width(); sX++) {
+                auto* sector = sectors.get(sX, sY);
+
+                // If the sector is entirely inside the area, then so are the origins of all its buildings.
+                if (area.contains(sector->bounds)) {
+                    for (auto it = sector->ownedBuildings.iterate(0, false); it.hasNext(); it.next())
+                        callback(*it.getValue());
+                    continue;
+                }
+
+                for (auto it = sector->ownedBuildings.iterate(0, false); it.hasNext(); it.next()) {
+                    Building* building = it.getValue();
+                    if (building->footprint.overlaps(area))
+                        callback(*building);
+                }
+            }
+        }
+    }
+
+    template<typename Callback>
+    void visit_buildings_overlapping_area(Rect2I area, Flags<BuildingQueryFlag> flags, Callback&& callback) const
+    {
+        const_cast<City*>(this)->visit_buildings_overlapping_area(area, flags, [&callback](Building const& building) {
+            callback(building);
+        });
+    }
+
+    // Visits only the buildings that have the problem, so this is proportional to how many do.
+    template<typename Callback>
+    void for_each_building_with_problem(BuildingProblem::Type problem_type, Callback&& callback)
+    {
+        for (auto it = buildingTickData.buildingsWithProblem[problem_type].iterate_set_bits(); it.has_next(); it.next())
+            callback(*buildings.get(it.get_index()));
+    }
+
+    s32 count_buildings_with_problem(BuildingProblem::Type problem_type) const
+    {
+        return buildingTickData.buildingsWithProblem[problem_type].set_bit_count();
+    }
+
+    BuildingsOverlappingArea buildings_overlapping_area(Rect2I area, Flags<BuildingQueryFlag> flags = {})
+    {
+        return { sectors, area, sectors_covered_by_building_query(area, flags) };
+    }
+
     void update();
 
     Building* add_building(BuildingDef* def, Rect2I footprint, Optional<GameTimestamp> const& = {});
@@ -67,12 +224,14 @@ struct City {
 
     void save_buildings(BinaryFileWriter* writer) const;
     bool load_buildings(BinaryFileReader* reader);
+    // Called once the city has been snapshotted for an autosave, so the next patch only has what changes after this.
+    void clear_unsaved_sectors();
 
     s32 calculate_demolition_cost(Rect2I area) const;
     void demolish_rect(Rect2I area);
 
     template<typename T>
-    Entity* add_entity(Entity::Type type, T* entityData)
+    Entity* add_entity(Entity::Type type, T* entityData, Rect2 bounds)
     {
         Indexed<Entity> entityRecord = entities.append();
         // logInfo("Adding entity #{0}"_s, {formatInt(entityRecord.index)});
@@ -89,9 +248,13 @@ struct City {
 
         entity.canBeDemolished = false;
 
+        entity.bounds = bounds;
+        add_entity_to_owner_sector(entity);
+
         return &entity;
     }
 
+    void move_entity(Entity* entity, Rect2 bounds);
     void remove_entity(Entity* entity);
     void draw_entities(Rect2I visibleTileBounds) const;
 
@@ -114,7 +277,9 @@ struct City {
     Rect2I bounds;
 
     Array2<s32> tileBuildingIndex; // NB: Index into buildings array, NOT Building.id!
+    BitArray tileHasBuilding;      // Packed (tileBuildingIndex != 0), indexed by (y * width) + x
     OccupancyArray<Building> buildings;
+    BuildingTickData buildingTickData;
     u32 highestBuildingID { 0 };
 
     SectorGrid<CitySector> sectors;
@@ -137,6 +302,7 @@ struct City {
     Rect2I demolitionRect;
 
     ArrayChunkPool<Building*> sectorBuildingsChunkPool;
+    ArrayChunkPool<Entity*> sectorEntitiesChunkPool;
     ArrayChunkPool<Rect2I> sectorBoundariesChunkPool;
     ArrayChunkPool<BuildingRef> buildingRefsChunkPool;
 
@@ -144,6 +310,31 @@ private:
     City(MemoryArena&, u32 width, u32 height, String name, String player_name, s32 funds, GameTimestamp date, float time_of_day);
 
     Building* add_building_direct(s32 id, BuildingDef* def, Rect2I footprint, GameTimestamp creationDate);
+    // Same as add_building_direct(), but doesn't notify the layers, and takes the building's look instead of picking one.
+    Building* insert_building(s32 id, BuildingDef* def, Rect2I footprint, GameTimestamp creationDate, u16 spriteOffset, Optional<s16> variantIndex = {});
+
+    void remove_building_from_owner_sector(Building&);
+    Rect2I sectors_covered_by_building_query(Rect2I area, Flags<BuildingQueryFlag>) const;
+
+    void update_building(s32 buildingIndex);
+
+    // Raw rects passed to mark_area_dirty(). One collects new marks while the other is read by the current update.
+    DirtyRects m_marked_areas[2];
+    u8 m_marking_index { 0 };
+    DirtyRects const& changed_area() const { return m_marked_areas[1 - m_marking_index]; }
+
+    struct DirtyAreaForRadius {
+        s32 radius;
+        DirtyRects area;
+        bool isCurrent;
+    };
+    Array<DirtyAreaForRadius> m_dirty_areas;
+    s32 m_next_building_update_index { 0 };
+
+    CitySector* get_entity_owner_sector(Entity const&);
+    void add_entity_to_owner_sector(Entity&);
+    void remove_entity_from_owner_sector(Entity&);
+    s32 m_max_entity_size { 0 }; // In tiles, rounded up. Used to find entities that poke into an area from another sector.
 };
 
 u8 const maxDistanceToWater = 10;
@@ -10,11 +10,9 @@
 #include <Menus/SaveFile.h>
 #include <Sim/City.h>
 #include <Sim/Effect.h>
-#include <Sim/LandValue.h>
 
 CrimeLayer::CrimeLayer(City& city, MemoryArena& arena)
-    : m_dirty_rects(arena, city.bounds)
-    , m_sectors(SectorGrid<BasicSector> { &arena, city.bounds.size(), 16, 8 })
+    : m_sectors(SectorGrid<BasicSector> { &arena, city.bounds.size(), 16, 8 })
     , m_tile_police_coverage(arena.allocate_array_2d<u8>(city.bounds.size()))
     , m_police_buildings(city.buildingRefsChunkPool)
     , m_total_jail_capacity(0)
@@ -28,11 +26,6 @@ void CrimeLayer::update(City& city)
 {
     DEBUG_FUNCTION_T(DebugCodeDataTag::Simulation);
 
-    if (m_dirty_rects.is_dirty()) {
-        DEBUG_BLOCK_T("updateCrimeLayer: dirty rects", DebugCodeDataTag::Simulation);
-        m_dirty_rects.clear();
-    }
-
     // Recalculate jail capacity
     // NB: This only makes sense if we assume that building jail capacities can change while
     // the game is running. It'll only happen incredibly rarely during normal play, but during
@@ -61,7 +54,7 @@ void CrimeLayer::update(City& city)
                         // Budget
                         float effectiveness = m_funding_level;
 
-                        if (!building->has_power()) {
+                        if (!building->has_power(city)) {
                             effectiveness *= 0.4f; // @Balance
 
                             // TODO: Consider water access too
@@ -75,12 +68,6 @@ void CrimeLayer::update(City& city)
     }
 }
 
-void CrimeLayer::mark_dirty(Rect2I bounds)
-{
-    // FIXME: Why are we using the land-value radius?
-    m_dirty_rects.mark_dirty(bounds.expanded(maxLandValueEffectDistance));
-}
-
 void CrimeLayer::notify_new_building(BuildingDef const& def, Building& building)
 {
     if (def.policeEffect.has_effect() || (def.jailCapacity > 0)) {
@@ -7,10 +7,10 @@
 #pragma once
 
 #include <IO/Forward.h>
-#include <Sim/DirtyRects.h>
 #include <Sim/Forward.h>
 #include <Sim/Layer.h>
 #include <Sim/Sector.h>
+#include <Util/ChunkedArray.h>
 #include <Util/Forward.h>
 
 class CrimeLayer final : public Layer {
@@ -20,7 +20,6 @@ public:
     virtual ~CrimeLayer() override = default;
 
     virtual void update(City&) override;
-    virtual void mark_dirty(Rect2I bounds) override;
 
     virtual void notify_new_building(BuildingDef const&, Building&) override;
     virtual void notify_building_demolished(BuildingDef const&, Building&) override;
@@ -35,8 +34,6 @@ public:
     virtual bool load(BinaryFileReader&, City&) override;
 
 private:
-    DirtyRects m_dirty_rects;
-
     SectorGrid<BasicSector> m_sectors;
 
     Array2<u8> m_tile_police_coverage;
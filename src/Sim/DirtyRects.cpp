@@ -5,81 +5,188 @@
  */
 
 #include "DirtyRects.h"
+#include <Debug/Debug.h>
+#include <Util/Maths.h>
+#include <Util/MemoryArena.h>
 
-DirtyRects::DirtyRects(MemoryArena& arena, Optional<Rect2I> bounds)
-    : m_bounds(move(bounds))
+DirtyRects::DirtyRects(MemoryArena& arena, Rect2I bounds)
+    : m_bounds(bounds)
+    , m_blocks_wide(divideCeil(bounds.width(), block_size))
+    , m_blocks_high(divideCeil(bounds.height(), block_size))
+    , m_dirty_blocks(arena, m_blocks_wide * m_blocks_high)
+    , m_full_blocks(arena, m_blocks_wide * m_blocks_high)
+    , m_blocks(arena.allocate_filled_array<Block>(m_blocks_wide * m_blocks_high))
     , m_rects(arena, 32)
+    // A row can have at most one run for every two tiles.
+    , m_open_runs(arena.allocate_array<Run>((bounds.width() / 2) + 1))
+    , m_row_runs(arena.allocate_array<Run>((bounds.width() / 2) + 1))
 {
 }
 
 void DirtyRects::mark_dirty(Rect2I rect)
 {
-    bool added = false;
-
-    if (m_bounds.has_value())
-        rect = rect.intersected(m_bounds.value());
+    rect = rect.intersected(m_bounds);
 
     // Skip empty rects
     if (!rect.has_positive_area())
         return;
 
-    if (m_rects.count > 128) {
-        logWarn("Over 128 dirty rects, which is probably a bug? (Count: {0}) Skipping duplicate checks."_s, { formatInt(m_rects.count) });
-        DEBUG_BREAK();
-    } else {
-        // Check to see if this rectangle is contained by an existing dirty rect
-        for (auto it = m_rects.iterate();
-            it.hasNext();
-            it.next()) {
-            auto& existingRect = it.get();
-
-            if (existingRect.contains(rect)) {
-                added = true;
-                break;
-            }
-        }
+    m_combined_dirty_rect = is_dirty() ? m_combined_dirty_rect.union_with(rect) : rect;
+    m_rects_are_current = false;
 
-        // Remove any existing rects that are inside our new one
-        if (!added) {
-            for (auto it = m_rects.iterateBackwards();
-                it.hasNext();
-                it.next()) {
-                Rect2I existingRect = it.getValue();
-                if (rect.contains(existingRect)) {
-                    m_rects.take_index(it.getIndex(), false);
-                }
+    // From here on, we work relative to the bounds.
+    s32 min_x = rect.x() - m_bounds.x();
+    s32 min_y = rect.y() - m_bounds.y();
+    s32 max_x = min_x + rect.width();
+    s32 max_y = min_y + rect.height();
+
+    for (s32 block_y = min_y / block_size; block_y <= (max_y - 1) / block_size; block_y++) {
+        s32 block_min_y = max(min_y - (block_y * block_size), 0);
+        s32 block_max_y = min(max_y - (block_y * block_size), block_size);
+
+        for (s32 block_x = min_x / block_size; block_x <= (max_x - 1) / block_size; block_x++) {
+            s32 block_index = (block_y * m_blocks_wide) + block_x;
+            if (m_full_blocks[block_index])
+                continue;
+
+            s32 block_min_x = max(min_x - (block_x * block_size), 0);
+            s32 block_max_x = min(max_x - (block_x * block_size), block_size);
+            u16 row_mask = static_cast<u16>(low_bits_mask(block_max_x - block_min_x) << block_min_x);
+
+            m_dirty_blocks.set_bit(block_index);
+            if (row_mask == 0xFFFF && block_min_y == 0 && block_max_y == block_size) {
+                // No need to touch the tile bitmap, it's all dirty.
+                m_full_blocks.set_bit(block_index);
+                continue;
             }
-        }
-    }
 
-    if (!added) {
-        m_rects.append(rect);
+            auto& block = m_blocks[block_index];
+            for (s32 row = block_min_y; row < block_max_y; row++)
+                block.rows[row] |= row_mask;
+        }
     }
 }
 
 void DirtyRects::clear()
 {
+    if (!is_dirty())
+        return;
+
+    // Only dirty blocks can have anything in their bitmaps.
+    for (auto it = m_dirty_blocks.iterate_set_bits(); it.has_next(); it.next())
+        m_blocks[it.get_index()] = {};
+
+    m_dirty_blocks.unset_all();
+    m_full_blocks.unset_all();
+    m_combined_dirty_rect = {};
     m_rects.clear();
+    m_rects_are_current = true;
+}
+
+ChunkedArray<Rect2I> const& DirtyRects::rects() const
+{
+    if (!m_rects_are_current)
+        rebuild_rects();
+
+    return m_rects;
+}
+
+u16 DirtyRects::block_row_bits(s32 block_index, s32 row_in_block) const
+{
+    if (m_full_blocks[block_index])
+        return 0xFFFF;
+    return m_blocks[block_index].rows[row_in_block];
 }
 
-bool DirtyRects::is_dirty() const
+bool DirtyRects::block_row_is_dirty(s32 block_y) const
 {
-    return m_rects.count > 0;
+    s32 first_index = block_y * m_blocks_wide;
+    for (s32 offset = 0; offset < m_blocks_wide; offset += 64) {
+        if (m_dirty_blocks.get_bits(first_index + offset, min(m_blocks_wide - offset, 64)) != 0)
+            return true;
+    }
+    return false;
 }
 
-Rect2I DirtyRects::combined_dirty_rect() const
+void DirtyRects::rebuild_rects() const
 {
-    Rect2I result { 0, 0, 0, 0 };
+    DEBUG_FUNCTION();
+
+    m_rects.clear();
+    m_open_runs.set_count(0);
 
-    if (m_rects.count > 0) {
-        result = m_rects.get(0);
+    auto close_run = [&](Run const& run, s32 end_y) {
+        m_rects.append(Rect2I { m_bounds.x() + run.x, m_bounds.y() + run.start_y, run.width, end_y - run.start_y });
+    };
 
-        for (auto it = m_rects.iterate(1, false);
-            it.hasNext();
-            it.next()) {
-            result = result.union_with(it.getValue());
+    for (s32 block_y = 0; block_y < m_blocks_high; block_y++) {
+        s32 block_min_y = block_y * block_size;
+
+        if (!block_row_is_dirty(block_y)) {
+            for (auto const& run : m_open_runs)
+                close_run(run, block_min_y);
+            m_open_runs.set_count(0);
+            continue;
+        }
+
+        s32 rows_in_block = min(block_size, m_bounds.height() - block_min_y);
+        for (s32 row = 0; row < rows_in_block; row++) {
+            s32 y = block_min_y + row;
+
+            // Collect this row's runs of dirty tiles, joining runs that continue across block edges.
+            m_row_runs.set_count(0);
+            s32 run_start = 0;
+            s32 run_end = -1;
+            for (s32 block_x = 0; block_x < m_blocks_wide; block_x++) {
+                s32 block_index = (block_y * m_blocks_wide) + block_x;
+                if (!m_dirty_blocks[block_index])
+                    continue;
+
+                u32 bits = block_row_bits(block_index, row);
+                while (bits != 0) {
+                    s32 start = count_trailing_zeros(bits);
+                    s32 length = count_trailing_zeros(~(bits >> start));
+                    bits &= ~(static_cast<u32>(low_bits_mask(length)) << start);
+
+                    s32 x = (block_x * block_size) + start;
+                    if (x == run_end) {
+                        run_end += length;
+                    } else {
+                        if (run_end > run_start)
+                            m_row_runs.append({ run_start, run_end - run_start, y });
+                        run_start = x;
+                        run_end = x + length;
+                    }
+                }
+            }
+            if (run_end > run_start)
+                m_row_runs.append({ run_start, run_end - run_start, y });
+
+            // Runs that exactly match an open run from the row above extend it downwards.
+            // Both lists are sorted by x, so we walk them together.
+            size_t open_index = 0;
+            for (auto& run : m_row_runs) {
+                while (open_index < m_open_runs.count() && m_open_runs[open_index].x < run.x)
+                    close_run(m_open_runs[open_index++], y);
+
+                if (open_index < m_open_runs.count() && m_open_runs[open_index].x == run.x) {
+                    auto const& open_run = m_open_runs[open_index++];
+                    if (open_run.width == run.width)
+                        run.start_y = open_run.start_y;
+                    else
+                        close_run(open_run, y);
+                }
+            }
+            while (open_index < m_open_runs.count())
+                close_run(m_open_runs[open_index++], y);
+
+            std::swap(m_open_runs, m_row_runs);
         }
     }
 
-    return result;
+    for (auto const& run : m_open_runs)
+        close_run(run, m_bounds.height());
+    m_open_runs.set_count(0);
+
+    m_rects_are_current = true;
 }
@@ -6,23 +6,57 @@
 
 #pragma once
 
+#include <Util/Array.h>
 #include <Util/Basic.h>
+#include <Util/BitArray.h>
 #include <Util/ChunkedArray.h>
 #include <Util/Rectangle.h>
 
+// Tracks which tiles within some bounds are dirty.
+// The bounds are split into 16x16-tile blocks. Each block has a dirty bit, a "whole block is dirty" bit,
+// and a bitmap with one u16 per tile row, which is only written when part of the block is dirty.
+// rects() turns that back into a list of non-overlapping rectangles, merging runs of tiles that line up.
 class DirtyRects {
 public:
     DirtyRects() = default; // FIXME: Temporary until users are initialized properly.
-    DirtyRects(MemoryArena&, Optional<Rect2I> bounds = {});
+    DirtyRects(MemoryArena&, Rect2I bounds);
 
     void mark_dirty(Rect2I);
     void clear();
-    bool is_dirty() const;
+    bool is_dirty() const { return !m_dirty_blocks.is_all_unset(); }
 
-    ChunkedArray<Rect2I> const& rects() const { return m_rects; }
-    Rect2I combined_dirty_rect() const;
+    // Non-overlapping rectangles covering every dirty tile. Rebuilt on the first call after a change.
+    ChunkedArray<Rect2I> const& rects() const;
+    Rect2I combined_dirty_rect() const { return m_combined_dirty_rect; }
 
 private:
-    Optional<Rect2I> m_bounds;
-    ChunkedArray<Rect2I> m_rects;
+    static constexpr s32 block_size = 16;
+    struct Block {
+        u16 rows[block_size];
+    };
+
+    // A horizontal run of dirty tiles, and the row where the rectangle it belongs to started.
+    struct Run {
+        s32 x;
+        s32 width;
+        s32 start_y;
+    };
+
+    u16 block_row_bits(s32 block_index, s32 row_in_block) const;
+    bool block_row_is_dirty(s32 block_y) const;
+    void rebuild_rects() const;
+
+    Rect2I m_bounds {};
+    s32 m_blocks_wide { 0 };
+    s32 m_blocks_high { 0 };
+    BitArray m_dirty_blocks;
+    BitArray m_full_blocks;
+    Array<Block> m_blocks;
+    Rect2I m_combined_dirty_rect {};
+
+    mutable ChunkedArray<Rect2I> m_rects;
+    mutable bool m_rects_are_current { true };
+    // Scratch space for rebuild_rects(): the open runs from the previous row, and the ones from this row.
+    mutable Array<Run> m_open_runs;
+    mutable Array<Run> m_row_runs;
 };
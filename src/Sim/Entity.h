@@ -20,6 +20,7 @@ struct Entity {
     };
 
     s32 index;
+    s32 ownerSectorIndex; // Our index in the owner CitySector's entities
     Type type;
     void* dataPointer; // Type-checked to match the `type`, see checkEntityMatchesType()
 
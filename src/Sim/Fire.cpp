@@ -46,6 +46,10 @@ void FireLayer::update(City& city)
 {
     DEBUG_FUNCTION_T(DebugCodeDataTag::Simulation);
 
+    // Combine the city's changes with our own.
+    for (auto it = city.dirty_area(m_max_fire_radius).rects().iterate(); it.hasNext(); it.next())
+        m_dirty_rects.mark_dirty(it.getValue());
+
     if (m_dirty_rects.is_dirty()) {
         DEBUG_BLOCK_T("updateFireLayer: building effects", DebugCodeDataTag::Simulation);
 
@@ -95,7 +99,7 @@ void FireLayer::update(City& city)
 
                         float effectiveness = m_funding_level;
 
-                        if (!building->has_power()) {
+                        if (!building->has_power(city)) {
                             effectiveness *= 0.4f; // @Balance
                         }
 
@@ -193,10 +197,11 @@ void FireLayer::add_fire_raw(City& city, s32 x, s32 y, GameTimestamp start_date)
 
     fire->pos = v2i(x, y);
     fire->startDate = start_date;
-    fire->entity = city.add_entity(Entity::Type::Fire, fire);
+    fire->entity = city.add_entity(Entity::Type::Fire, fire, { x, y, 1, 1 });
     // TODO: Probably most of this wants to be moved into addEntity()
-    fire->entity->bounds = { x, y, 1, 1 };
     fire->entity->sprite = SpriteRef { "e_fire_1x1"_s, App::the().cosmetic_random().next() };
+    // Entities are sorted by depth when drawn, so make sure fires end up on top of the building that's burning.
+    fire->entity->depth = 1.0f;
 
     m_active_fire_count++;
 
@@ -298,16 +303,11 @@ bool FireLayer::load(BinaryFileReader& reader, City& city)
             break;
 
         // Active fires
-        Array<SAVFire> tempFires = reader.arena->allocate_array<SAVFire>(section->activeFireCount);
-        if (!reader.readArray(section->activeFires, &tempFires))
+        auto savFires = reader.readArray<SAVFire>(section->activeFires);
+        if (!savFires.has_value())
             break;
-        for (u32 activeFireIndex = 0;
-            activeFireIndex < section->activeFireCount;
-            activeFireIndex++) {
-            SAVFire* savFire = &tempFires[activeFireIndex];
-
-            add_fire_raw(city, savFire->x, savFire->y, savFire->startDate);
-        }
+        for (auto const& savFire : savFires.value())
+            add_fire_raw(city, savFire.x, savFire.y, savFire.startDate);
         ASSERT((u32)m_active_fire_count == section->activeFireCount);
 
         succeeded = true;
@@ -38,7 +38,7 @@ public:
     virtual ~FireLayer() override = default;
 
     virtual void update(City&) override;
-    virtual void mark_dirty(Rect2I bounds) override;
+    virtual Optional<s32> dirty_area_radius() const override { return m_max_fire_radius; }
 
     Optional<Indexed<Fire>> find_fire_at(s32 x, s32 y);
     bool does_area_contain_fire(Rect2I bounds) const;
@@ -62,6 +62,9 @@ public:
     virtual bool load(BinaryFileReader&, City&) override;
 
 private:
+    // Fires starting or going out only affect this layer, so we track those here rather than via City::mark_area_dirty().
+    void mark_dirty(Rect2I bounds);
+
     u8 m_max_fire_radius { 4 };
     DirtyRects m_dirty_rects;
 
@@ -120,8 +120,13 @@ void inspectTileWindowProc(UI::WindowContext* context, void* userData)
 
         // Problems
         for (auto problem_type : enum_values<BuildingProblem::Type>()) {
-            if (building->has_problem(problem_type)) {
-                ui->addLabel(myprintf("- PROBLEM: {0}"_s, { getText(buildingProblemNames[problem_type]) }));
+            if (building->has_problem(problem_type, *city)) {
+                s32 otherBuildingCount = city->count_buildings_with_problem(problem_type) - 1;
+                if (otherBuildingCount > 0) {
+                    ui->addLabel(myprintf("- PROBLEM: {0} (along with {1} other buildings)"_s, { getText(buildingProblemNames[problem_type]), formatInt(otherBuildingCount) }));
+                } else {
+                    ui->addLabel(myprintf("- PROBLEM: {0}"_s, { getText(buildingProblemNames[problem_type]) }));
+                }
             }
         }
     } else {
@@ -449,7 +454,8 @@ ErrorOr<OwnedRef<GameScene>> GameScene::from_saved_game(SavedGameInfo const& sav
 {
     auto game_scene = adopt_own(*new GameScene);
 
-    FileHandle saveFile = openFile(saved_game_info.fullPath, FileAccessMode::Read);
+    SavedGameFiles saveFiles;
+    open_saved_game_files(saveFiles, saved_game_info.fullPath, saved_game_info.shortName);
     bool loadSucceeded = [&] {
         // So... I'm not really sure how to signal success, honestly.
         // I suppose the process ouytside of this function is:
@@ -463,20 +469,41 @@ ErrorOr<OwnedRef<GameScene>> GameScene::from_saved_game(SavedGameInfo const& sav
         // successfully loads... but that makes a bunch of memory-management more complicated.
         // This way, we only ever have one City in memory so we can clean up easily.
 
-        // For now, reading the whole thing into memory and then processing it is simpler.
-        // However, it's wasteful memory-wise, so if save files get big we might want to
-        // read the file a bit at a time. @Size
+        // We stream the file one section at a time: each section is only held in memory until
+        // whatever reads it is done, and then endSection() throws it away, along with any
+        // temporary allocations made while reading it. So, the most we ever hold at once is
+        // about the size of the largest section, instead of the whole file.
+
+        // Autosaves may have patches. Sections with tile arrays are loaded from the base and then
+        // each patch in turn, and everything else comes from the newest file. See SAV_PATCH_ID.
 
         bool succeeded = false;
 
         OwnedPtr<City> city;
 
-        BinaryFileReader reader = readBinaryFile(&saveFile, SAV_FILE_ID, &temp_arena());
+        BinaryFileReader& reader = saveFiles.newest();
+        auto load_section = [](BinaryFileReader& from, auto&& load) {
+            bool section_succeeded = load(from);
+            from.endSection();
+            return section_succeeded;
+        };
+        auto load_patched_section = [&](auto&& load) {
+            for (auto& from : saveFiles.all()) {
+                if (!load_section(from, load))
+                    return false;
+            }
+            return true;
+        };
+
         // This doesn't actually loop, we're just using a `while` so we can break out of it
         while (reader.isValidFile) {
             // META
-            if (reader.startSection(SAV_META_ID, SAV_META_VERSION)) {
+            bool loaded_meta = load_section(reader, [&](BinaryFileReader&) {
+                if (!reader.startSection(SAV_META_ID, SAV_META_VERSION))
+                    return false;
                 SAVSection_Meta* meta = reader.readStruct<SAVSection_Meta>(0);
+                if (!meta)
+                    return false;
 
                 String cityName = reader.readString(meta->cityName);
                 String playerName = reader.readString(meta->playerName);
@@ -486,20 +513,23 @@ ErrorOr<OwnedRef<GameScene>> GameScene::from_saved_game(SavedGameInfo const& sav
                 auto& world_camera = the_renderer().world_camera();
                 world_camera.set_position(v2(meta->cameraX, meta->cameraY));
                 world_camera.set_zoom(meta->cameraZoom);
-            } else {
+                return true;
+            });
+            if (!loaded_meta)
                 break;
-            }
 
-            if (!city->terrainLayer.load(reader))
+            if (!load_patched_section([&](BinaryFileReader& from) { return city->terrainLayer.load(from); }))
                 break;
-            if (!city->load_buildings(&reader))
+            if (!load_section(reader, [&](BinaryFileReader& from) { return city->load_buildings(&from); }))
                 break;
-            if (!city->zoneLayer.load(reader))
+            if (!load_patched_section([&](BinaryFileReader& from) { return city->zoneLayer.load(from); }))
                 break;
 
             bool any_city_layer_failed_to_load = false;
             for (auto& layer : city->m_layers) {
-                if (!layer->load(reader, *city)) {
+                auto load_layer = [&](BinaryFileReader& from) { return layer->load(from, *city); };
+                bool loaded = layer->saves_sector_patches() ? load_patched_section(load_layer) : load_section(reader, load_layer);
+                if (!loaded) {
                     any_city_layer_failed_to_load = true;
                     break;
                 }
@@ -516,7 +546,6 @@ ErrorOr<OwnedRef<GameScene>> GameScene::from_saved_game(SavedGameInfo const& sav
 
         return succeeded;
     }();
-    closeFile(&saveFile);
 
     if (!loadSucceeded)
         return getText("msg_load_failure"_s, { saved_game_info.shortName });
@@ -540,6 +569,7 @@ void GameScene::update_and_render(float delta_time)
     City& city = *m_city;
 
     // Update the simulation... need a smarter way of doing this!
+    bool should_autosave = false;
     if (!UI::hasPauseWindowOpen()) {
         DEBUG_BLOCK_T("Update simulation", DebugCodeDataTag::Simulation);
 
@@ -555,8 +585,13 @@ void GameScene::update_and_render(float delta_time)
         }
 
         city.update();
+
+        should_autosave = clockEvents.has(ClockEvents::NewMonth);
     }
 
+    // We're between ticks here, so this is a consistent point to take a snapshot of the city.
+    m_autosave.update(city, should_autosave);
+
     // UI!
     update_and_render_game_ui();
 
@@ -648,6 +683,7 @@ void GameScene::init_data_view_ui()
     setFixedColors(&m_data_view_ui[DataView::Power], "power"_s, { "data_view_power_powered"_s, "data_view_power_brownout"_s, "data_view_power_blackout"_s }, m_arena);
 
     setHighlightedBuildings(&m_data_view_ui[DataView::Power], city.powerLayer.power_buildings());
+    setHighlightedProblem(&m_data_view_ui[DataView::Power], BuildingProblem::Type::NoPower);
     setTileOverlayCallback(&m_data_view_ui[DataView::Power], [](City* city, s32 x, s32 y) { return city->powerLayer.calculate_power_overlay_for_tile(x, y); }, "power"_s);
 }
 
@@ -673,6 +709,11 @@ void setHighlightedBuildings(DataViewUI* dataView, ChunkedArray<BuildingRef>* hi
     dataView->effectRadiusMember = effectRadiusMember;
 }
 
+void setHighlightedProblem(DataViewUI* dataView, BuildingProblem::Type problem_type)
+{
+    dataView->highlightedProblem = problem_type;
+}
+
 void setTileOverlay(DataViewUI* dataView, Array2<u8>* tileData, String paletteName)
 {
     dataView->overlayTileData = tileData;
@@ -701,7 +742,7 @@ static void drawBuildingHighlights(City* city, Iterable* buildingRefs)
             Building* building = city->get_building(it.getValue());
             // NB: If we're doing this in a separate loop, we could crop out buildings that aren't in the visible tile bounds
             if (building != nullptr) {
-                s32 paletteIndex = (building->has_power() ? paletteIndexPowered : paletteIndexUnpowered);
+                s32 paletteIndex = (building->has_power(*city) ? paletteIndexPowered : paletteIndexUnpowered);
                 addUntexturedRect(buildingHighlights, building->footprint, buildingsPalette.colour_at(paletteIndex));
             }
         }
@@ -709,6 +750,24 @@ static void drawBuildingHighlights(City* city, Iterable* buildingRefs)
     }
 }
 
+static void drawBuildingsWithProblem(City* city, BuildingProblem::Type problem_type)
+{
+    DEBUG_FUNCTION_T(DebugCodeDataTag::GameUpdate);
+    auto& renderer = the_renderer();
+
+    s32 buildingCount = city->count_buildings_with_problem(problem_type);
+    if (buildingCount > 0) {
+        auto& buildingsPalette = Palette::get("service_buildings"_s);
+        s32 paletteIndexUnpowered = 1;
+
+        DrawRectsGroup* buildingHighlights = beginRectsGroupUntextured(&renderer.world_overlay_buffer(), renderer.shaderIds.untextured, buildingCount);
+        city->for_each_building_with_problem(problem_type, [&](Building& building) {
+            addUntexturedRect(buildingHighlights, building.footprint, buildingsPalette.colour_at(paletteIndexUnpowered));
+        });
+        endRectsGroup(buildingHighlights);
+    }
+}
+
 template<typename Iterable>
 static void drawBuildingEffectRadii(City* city, Iterable* buildingRefs, EffectRadius BuildingDef::* effectMember)
 {
@@ -752,7 +811,7 @@ static void drawBuildingEffectRadii(City* city, Iterable* buildingRefs, EffectRa
                 auto& def = building->get_def();
                 auto* effect = &(def.*effectMember);
                 if (effect->has_effect()) {
-                    s32 paletteIndex = (building->has_power() ? paletteIndexPowered : paletteIndexUnpowered);
+                    s32 paletteIndex = (building->has_power(*city) ? paletteIndexPowered : paletteIndexUnpowered);
                     addRing(buildingRadii, building->footprint.centre(), static_cast<float>(effect->radius()), 0.5f, ringsPalette.colour_at(paletteIndex));
                 }
             }
@@ -802,6 +861,9 @@ void GameScene::draw_data_view_overlay(Rect2I visible_tile_bounds) const
         drawGrid(&renderer.world_overlay_buffer(), visible_tile_bounds, overlayTileData, overlayPalette.colours());
     }
 
+    if (dataView.highlightedProblem.has_value())
+        drawBuildingsWithProblem(&city, dataView.highlightedProblem.value());
+
     if (dataView.highlightedBuildings) {
         drawBuildingHighlights(&city, dataView.highlightedBuildings);
 
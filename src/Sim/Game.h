@@ -7,12 +7,14 @@
 #pragma once
 
 #include <App/Scene.h>
+#include <Menus/Autosave.h>
 #include <Menus/SavedGames.h>
 #include <Sim/BuildingRef.h>
 #include <Sim/City.h>
 #include <Util/Basic.h>
 #include <Util/ChunkedArray.h>
 #include <Util/EnumMap.h>
+#include <Util/Optional.h>
 #include <Util/Random.h>
 #include <Util/Ref.h>
 #include <Util/String.h>
@@ -58,6 +60,7 @@ struct DataViewUI {
     // Overlay
     ChunkedArray<BuildingRef>* highlightedBuildings;
     EffectRadius BuildingDef::* effectRadiusMember;
+    Optional<BuildingProblem::Type> highlightedProblem;
     String overlayPaletteName;
     // NB: This is a pointer to the variable, not pointer to the array itself!
     // The DataViewUI data gets initialised before a City exists, so the per-tile arrays
@@ -76,6 +79,7 @@ void showCostTooltip(s32 buildCost);
 void setGradient(DataViewUI* dataViewUI, String paletteName);
 void setFixedColors(DataViewUI* dataView, String paletteName, std::initializer_list<String> names, MemoryArena&);
 void setHighlightedBuildings(DataViewUI* dataViewUI, ChunkedArray<BuildingRef>* highlightedBuildings, EffectRadius BuildingDef::* effectRadiusMember = nullptr);
+void setHighlightedProblem(DataViewUI* dataViewUI, BuildingProblem::Type);
 void setTileOverlay(DataViewUI* dataViewUI, Array2<u8>* tileData, String paletteName);
 void setTileOverlayCallback(DataViewUI* dataViewUI, DataViewUI::CalculateTileValue, String paletteName);
 
@@ -114,6 +118,7 @@ private:
 
     MemoryArena m_arena { "Game"_s };
     OwnedPtr<City> m_city;
+    Autosave m_autosave;
 
     EnumMap<DataView, DataViewUI> m_data_view_ui;
     DataView m_active_data_view { DataView::None };
@@ -12,8 +12,7 @@
 #include <Sim/Effect.h>
 
 HealthLayer::HealthLayer(City& city, MemoryArena& arena)
-    : m_dirty_rects(arena, city.bounds)
-    , m_sectors(&arena, city.bounds.size(), 16, 8)
+    : m_sectors(&arena, city.bounds.size(), 16, 8)
     , m_tile_health_coverage(arena.allocate_array_2d<u8>(city.bounds.size()))
     , m_health_buildings(city.buildingRefsChunkPool)
     , m_funding_level(1.0f)
@@ -25,14 +24,6 @@ void HealthLayer::update(City& city)
 {
     DEBUG_FUNCTION_T(DebugCodeDataTag::Simulation);
 
-    if (m_dirty_rects.is_dirty()) {
-        DEBUG_BLOCK_T("updateHealthLayer: dirty rects", DebugCodeDataTag::Simulation);
-
-        // TODO: do we actually need dirty rects? I can't think of anything, unless we move the "register building" stuff to that.
-
-        m_dirty_rects.clear();
-    }
-
     {
         DEBUG_BLOCK_T("updateHealthLayer: sector updates", DebugCodeDataTag::Simulation);
 
@@ -50,7 +41,7 @@ void HealthLayer::update(City& city)
                     float effectiveness = m_funding_level;
 
                     // Power
-                    if (!building->has_power()) {
+                    if (!building->has_power(city)) {
                         effectiveness *= 0.4f; // @Balance
                     }
 
@@ -65,12 +56,6 @@ void HealthLayer::update(City& city)
     }
 }
 
-void HealthLayer::mark_dirty(Rect2I bounds)
-{
-    // FIXME: Why are we using the land-value radius?
-    m_dirty_rects.mark_dirty(bounds.expanded(maxLandValueEffectDistance));
-}
-
 void HealthLayer::notify_new_building(BuildingDef const& def, Building& building)
 {
     if (def.healthEffect.has_effect()) {
@@ -12,42 +12,43 @@
 #include <Sim/Effect.h>
 
 LandValueLayer::LandValueLayer(City& city, MemoryArena& arena)
-    : m_dirty_rects(arena, city.bounds)
 {
     m_sectors = SectorGrid<BasicSector> { &arena, city.bounds.size(), 16, 8 };
 
     m_tile_land_value = arena.allocate_array_2d<u8>(city.bounds.size());
     m_tile_land_value.fill(0);
+    m_unsaved_sectors = { arena, city.bounds };
 
     m_tile_building_contributions = arena.allocate_array_2d<s16>(city.bounds.size());
     m_tile_building_contributions.fill(0);
 }
 
-void LandValueLayer::mark_dirty(Rect2I bounds)
+Optional<s32> LandValueLayer::dirty_area_radius() const
 {
-    m_dirty_rects.mark_dirty(bounds.expanded(maxLandValueEffectDistance));
+    return maxLandValueEffectDistance;
 }
 
 void LandValueLayer::update(City& city)
 {
     DEBUG_FUNCTION_T(DebugCodeDataTag::Simulation);
 
-    if (m_dirty_rects.is_dirty()) {
+    auto const& dirtyArea = city.dirty_area(maxLandValueEffectDistance);
+    if (dirtyArea.is_dirty()) {
         {
             DEBUG_BLOCK_T("updateLandValueLayer: building effects", DebugCodeDataTag::Simulation);
 
             // Recalculate the building contributions
-            for (auto rectIt = m_dirty_rects.rects().iterate();
+            for (auto rectIt = dirtyArea.rects().iterate();
                 rectIt.hasNext();
                 rectIt.next()) {
                 Rect2I dirtyRect = rectIt.getValue();
 
                 m_tile_building_contributions.fill_region(dirtyRect, 0);
 
-                city.for_each_building_overlapping_area(dirtyRect.expanded(maxLandValueEffectDistance), {}, [&](auto& building) {
+                for (auto& building : city.buildings_overlapping_area(dirtyRect.expanded(maxLandValueEffectDistance))) {
                     auto& def = building.get_def();
                     def.landValueEffect.apply(m_tile_building_contributions, dirtyRect, building.footprint.centre(), EffectType::Add);
-                });
+                }
 
                 //
                 // Now, clamp the tile values into the range we want!
@@ -70,8 +71,6 @@ void LandValueLayer::update(City& city)
                 }
             }
         }
-
-        m_dirty_rects.clear();
     }
 
     // Recalculate overall value
@@ -80,6 +79,9 @@ void LandValueLayer::update(City& city)
 
         for (s32 i = 0; i < m_sectors.sectors_to_update_per_tick(); i++) {
             auto [_, sector] = m_sectors.get_next_sector();
+            // Every sector gets recalculated in turn, but most of the time nothing changes, so only
+            // count it as needing saving if it did.
+            bool sector_changed = false;
 
             for (s32 y = sector.bounds.y(); y < sector.bounds.y() + sector.bounds.height(); y++) {
                 for (s32 x = sector.bounds.x(); x < sector.bounds.x() + sector.bounds.width(); x++) {
@@ -121,9 +123,16 @@ void LandValueLayer::update(City& city)
                     float pollutionEffect = city.pollutionLayer.get_pollution_percent_at(x, y) * 0.1f;
                     landValue -= pollutionEffect;
 
-                    m_tile_land_value.set(x, y, clamp01AndMap_u8(landValue));
+                    u8 newLandValue = clamp01AndMap_u8(landValue);
+                    if (m_tile_land_value.get(x, y) != newLandValue) {
+                        m_tile_land_value.set(x, y, newLandValue);
+                        sector_changed = true;
+                    }
                 }
             }
+
+            if (sector_changed)
+                m_unsaved_sectors.mark_changed(sector.bounds);
         }
     }
 }
@@ -139,7 +148,7 @@ void LandValueLayer::save(BinaryFileWriter& writer) const
     SAVSection_LandValue landValueSection = {};
 
     // Tile land value
-    landValueSection.tileLandValue = writer.appendBlob(&m_tile_land_value, FileBlobCompressionScheme::RLE_S8);
+    writer.appendBlob(&landValueSection.tileLandValue, &m_tile_land_value, FileBlobCompressionScheme::Smallest, { .rowLength = m_tile_land_value.width() }, m_unsaved_sectors.for_saving());
 
     writer.endSection<SAVSection_LandValue>(&landValueSection);
 }
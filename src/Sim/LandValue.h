@@ -7,9 +7,9 @@
 #pragma once
 
 #include <IO/Forward.h>
-#include <Sim/DirtyRects.h>
 #include <Sim/Forward.h>
 #include <Sim/Layer.h>
+#include <Sim/UnsavedSectors.h>
 #include <Sim/Sector.h>
 
 class LandValueLayer final : public Layer {
@@ -19,7 +19,7 @@ public:
     virtual ~LandValueLayer() override = default;
 
     virtual void update(City&) override;
-    virtual void mark_dirty(Rect2I bounds) override;
+    virtual Optional<s32> dirty_area_radius() const override;
 
     float get_land_value_percent_at(s32 x, s32 y) const;
 
@@ -28,12 +28,14 @@ public:
 
     virtual void save(BinaryFileWriter&) const override;
     virtual bool load(BinaryFileReader&, City&) override;
+    virtual bool saves_sector_patches() const override { return true; }
+    virtual void clear_unsaved_sectors() override { m_unsaved_sectors.clear(); }
 
 private:
-    DirtyRects m_dirty_rects;
     SectorGrid<BasicSector> m_sectors;
     Array2<s16> m_tile_building_contributions;
     Array2<u8> m_tile_land_value; // Cached total
+    UnsavedSectors m_unsaved_sectors;
 };
 
 s32 const maxLandValueEffectDistance = 16; // TODO: Better value for this!
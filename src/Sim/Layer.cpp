@@ -5,3 +5,10 @@
  */
 
 #include "Layer.h"
+#include <Sim/Building.h>
+
+void Layer::notify_new_buildings(Span<Building*> buildings)
+{
+    for (auto* building : buildings)
+        notify_new_building(building->get_def(), *building);
+}
@@ -7,18 +7,32 @@
 #pragma once
 
 #include <Sim/Forward.h>
+#include <Util/Optional.h>
 #include <Util/Rectangle.h>
+#include <Util/Span.h>
 
 class Layer {
 public:
     virtual ~Layer() = default;
 
     virtual void update(City&) { }
-    virtual void mark_dirty(Rect2I bounds) { }
+
+    // How far (in tiles) a change to the city spreads in this layer. Layers that return a value here can get the
+    // area they need to recalculate from City::dirty_area() with that radius, during update().
+    virtual Optional<s32> dirty_area_radius() const { return {}; }
 
     virtual void notify_new_building(BuildingDef const&, Building&) { }
+    // Called instead of notify_new_building() when placing many buildings at once.
+    // By default, calls notify_new_building() for each one.
+    virtual void notify_new_buildings(Span<Building*>);
     virtual void notify_building_demolished(BuildingDef const&, Building&) { }
 
     virtual void save(BinaryFileWriter&) const = 0;
     virtual bool load(BinaryFileReader&, City&) = 0;
+
+    // Layers with tile arrays only write the sectors that changed into autosave patches. When loading,
+    // they load from the base file and then from each patch in turn, so load() has to cope with that.
+    // Other layers save everything every time, so they only load from the newest file.
+    virtual bool saves_sector_patches() const { return false; }
+    virtual void clear_unsaved_sectors() { }
 };
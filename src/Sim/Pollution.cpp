@@ -12,13 +12,12 @@
 #include <Sim/Building.h>
 #include <Sim/City.h>
 #include <Sim/Effect.h>
-#include <Sim/LandValue.h>
 
 PollutionLayer::PollutionLayer(City& city, MemoryArena& arena)
-    : m_dirty_rects(arena, city.bounds)
 {
     m_tile_pollution = arena.allocate_array_2d<u8>(city.bounds.size());
     m_tile_pollution.fill(0);
+    m_unsaved_sectors = { arena, city.bounds };
 
     m_tile_building_contributions = arena.allocate_array_2d<s16>(city.bounds.size());
     m_tile_building_contributions.fill(0);
@@ -28,23 +27,24 @@ void PollutionLayer::update(City& city)
 {
     DEBUG_FUNCTION_T(DebugCodeDataTag::Simulation);
 
-    if (m_dirty_rects.is_dirty()) {
+    auto const& dirtyArea = city.dirty_area(maxPollutionEffectDistance);
+    if (dirtyArea.is_dirty()) {
         // @Copypasta from updateLandValueLayer()
         {
             DEBUG_BLOCK_T("updatePollutionLayer: building effects", DebugCodeDataTag::Simulation);
 
             // Recalculate the building contributions
-            for (auto rectIt = m_dirty_rects.rects().iterate();
+            for (auto rectIt = dirtyArea.rects().iterate();
                 rectIt.hasNext();
                 rectIt.next()) {
                 Rect2I dirtyRect = rectIt.getValue();
 
                 m_tile_building_contributions.fill_region(dirtyRect, 0);
 
-                city.for_each_building_overlapping_area(dirtyRect.expanded(maxLandValueEffectDistance), {}, [&](auto& building) {
+                for (auto& building : city.buildings_overlapping_area(dirtyRect.expanded(maxPollutionEffectDistance))) {
                     auto& def = building.get_def();
                     def.pollutionEffect.apply(m_tile_building_contributions, dirtyRect, building.footprint.centre(), EffectType::Add);
-                });
+                }
 
                 // Now, clamp the tile values into the range we want!
                 // The above process may have overflowed the -255 to 255 range we want the values to be,
@@ -71,10 +71,11 @@ void PollutionLayer::update(City& city)
         {
             DEBUG_BLOCK_T("updatePollutionLayer: combine", DebugCodeDataTag::Simulation);
 
-            for (auto rectIt = m_dirty_rects.rects().iterate();
+            for (auto rectIt = dirtyArea.rects().iterate();
                 rectIt.hasNext();
                 rectIt.next()) {
                 Rect2I dirtyRect = rectIt.getValue();
+                m_unsaved_sectors.mark_changed(dirtyRect);
 
                 for (s32 y = dirtyRect.y(); y < dirtyRect.y() + dirtyRect.height(); y++) {
                     for (s32 x = dirtyRect.x(); x < dirtyRect.x() + dirtyRect.width(); x++) {
@@ -91,14 +92,12 @@ void PollutionLayer::update(City& city)
                 }
             }
         }
-
-        m_dirty_rects.clear();
     }
 }
 
-void PollutionLayer::mark_dirty(Rect2I bounds)
+Optional<s32> PollutionLayer::dirty_area_radius() const
 {
-    m_dirty_rects.mark_dirty(bounds.expanded(maxPollutionEffectDistance));
+    return maxPollutionEffectDistance;
 }
 
 float PollutionLayer::get_pollution_percent_at(s32 x, s32 y) const
@@ -112,7 +111,7 @@ void PollutionLayer::save(BinaryFileWriter& writer) const
     SAVSection_Pollution pollutionSection = {};
 
     // Tile pollution
-    pollutionSection.tilePollution = writer.appendBlob(&m_tile_pollution, FileBlobCompressionScheme::RLE_S8);
+    writer.appendBlob(&pollutionSection.tilePollution, &m_tile_pollution, FileBlobCompressionScheme::Smallest, { .rowLength = m_tile_pollution.width() }, m_unsaved_sectors.for_saving());
 
     writer.endSection<SAVSection_Pollution>(&pollutionSection);
 }
@@ -7,9 +7,10 @@
 #pragma once
 
 #include <IO/Forward.h>
-#include <Sim/DirtyRects.h>
 #include <Sim/Forward.h>
 #include <Sim/Layer.h>
+#include <Sim/UnsavedSectors.h>
+#include <Util/Array2.h>
 
 class PollutionLayer final : public Layer {
 public:
@@ -18,7 +19,7 @@ public:
     virtual ~PollutionLayer() override = default;
 
     virtual void update(City&) override;
-    virtual void mark_dirty(Rect2I bounds) override;
+    virtual Optional<s32> dirty_area_radius() const override;
 
     float get_pollution_percent_at(s32 x, s32 y) const;
 
@@ -27,13 +28,14 @@ public:
 
     virtual void save(BinaryFileWriter&) const override;
     virtual bool load(BinaryFileReader&, City&) override;
+    virtual bool saves_sector_patches() const override { return true; }
+    virtual void clear_unsaved_sectors() override { m_unsaved_sectors.clear(); }
 
 private:
-    DirtyRects m_dirty_rects;
-
     Array2<s16> m_tile_building_contributions;
 
     Array2<u8> m_tile_pollution; // Cached total
+    UnsavedSectors m_unsaved_sectors;
 };
 
 s32 const maxPollutionEffectDistance = 16; // TODO: Better value for this!
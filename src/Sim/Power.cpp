@@ -13,7 +13,6 @@
 
 PowerLayer::PowerLayer(City& city, MemoryArena& arena)
     : m_bounds(city.bounds)
-    , m_dirty_rects(arena, m_bounds)
     , m_sectors(&arena, m_bounds.size(), 16, 0)
     , m_tile_power_distance(arena.allocate_array_2d<u8>(m_bounds.size()))
     , m_networks(arena, 64)
@@ -111,7 +110,7 @@ void PowerSector::update_power_values(City& city)
     }
 
     // Count power from buildings
-    city.for_each_building_overlapping_area(bounds, BuildingQueryFlag::RequireOriginInArea, [&](auto& building) {
+    city.visit_buildings_overlapping_area(bounds, BuildingQueryFlag::RequireOriginInArea, [&](auto& building) {
         auto& def = building.get_def();
         if (def.power != 0) {
             u8 powerGroupIndex = get_power_group_id(building.footprint.x() - bounds.x(), building.footprint.y() - bounds.y());
@@ -222,11 +221,6 @@ void PowerSector::set_rect_power_group_unknown(Rect2I area)
     }
 }
 
-void PowerLayer::mark_dirty(Rect2I bounds)
-{
-    m_dirty_rects.mark_dirty(bounds.expanded(m_power_max_distance));
-}
-
 void PowerLayer::recalculate_sector_power_groups(City& city, PowerSector& sector)
 {
     DEBUG_FUNCTION();
@@ -290,7 +284,7 @@ void PowerLayer::recalculate_sector_power_groups(City& city, PowerSector& sector
         return;
 
     // Store references to the buildings in each group, for faster updating later
-    city.for_each_building_overlapping_area(sector.bounds, {}, [&](auto& building) {
+    city.visit_buildings_overlapping_area(sector.bounds, {}, [&](auto& building) {
         auto& def = building.get_def();
         if (def.power == 0)
             return; // We only care about powered buildings!
@@ -522,10 +516,11 @@ void PowerLayer::update(City& city)
 {
     DEBUG_FUNCTION_T(DebugCodeDataTag::Simulation);
 
-    if (m_dirty_rects.is_dirty()) {
+    auto const& dirtyArea = city.dirty_area(m_power_max_distance);
+    if (dirtyArea.is_dirty()) {
         HashSet<PowerSector*> touched_sectors;
 
-        for (auto it = m_dirty_rects.rects().iterate();
+        for (auto it = dirtyArea.rects().iterate();
             it.hasNext();
             it.next()) {
             Rect2I dirtyRect = it.getValue();
@@ -559,7 +554,7 @@ void PowerLayer::update(City& city)
         }
 
         // Recalculate distance
-        updateDistances(&m_tile_power_distance, &m_dirty_rects, m_power_max_distance);
+        updateDistances(&m_tile_power_distance, &dirtyArea, m_power_max_distance);
 
         // Rebuild the sectors that were modified
         for (auto* sector : touched_sectors) {
@@ -567,7 +562,6 @@ void PowerLayer::update(City& city)
         }
 
         recalculate_power_connectivity();
-        m_dirty_rects.clear();
     }
 
     m_cached_combined_production = 0;
@@ -642,7 +636,7 @@ void PowerLayer::update(City& city)
                 if (building != nullptr) {
                     switch (networkMode) {
                     case NetworkMode::Blackout: {
-                        building->allocatedPower = 0;
+                        building->set_allocated_power(0, city);
                     } break;
 
                     case NetworkMode::Brownout: {
@@ -651,15 +645,15 @@ void PowerLayer::update(City& city)
                         // and unpowered over time to even things out, instead of it always being first-come-first-served.
                         s32 requiredPower = building->required_power();
                         if (powerRemaining >= requiredPower) {
-                            building->allocatedPower = requiredPower;
+                            building->set_allocated_power(requiredPower, city);
                             powerRemaining -= requiredPower;
                         } else {
-                            building->allocatedPower = 0;
+                            building->set_allocated_power(0, city);
                         }
                     } break;
 
                     case NetworkMode::FullCoverage: {
-                        building->allocatedPower = building->required_power();
+                        building->set_allocated_power(building->required_power(), city);
                     } break;
                     }
                 }
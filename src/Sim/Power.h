@@ -7,7 +7,6 @@
 #pragma once
 
 #include <Sim/Building.h>
-#include <Sim/DirtyRects.h>
 #include <Sim/Layer.h>
 #include <Sim/Sector.h>
 
@@ -56,7 +55,7 @@ public:
     virtual ~PowerLayer() override = default;
 
     virtual void update(City&) override;
-    virtual void mark_dirty(Rect2I bounds) override;
+    virtual Optional<s32> dirty_area_radius() const override { return m_power_max_distance; }
 
     virtual void notify_new_building(BuildingDef const&, Building&) override;
     virtual void notify_building_demolished(BuildingDef const&, Building&) override;
@@ -87,8 +86,6 @@ private:
     Rect2I m_bounds;
 
     u8 m_power_max_distance { 2 };
-    DirtyRects m_dirty_rects;
-
     SectorGrid<PowerSector> m_sectors;
 
     Array2<u8> m_tile_power_distance;
@@ -24,9 +24,11 @@ TerrainLayer::TerrainLayer(City& city, MemoryArena& arena)
     , m_tile_terrain_type(arena.allocate_array_2d<u8>(m_bounds.size()))
     , m_tile_height(arena.allocate_array_2d<u8>(m_bounds.size()))
     , m_tile_distance_to_water(arena.allocate_array_2d<u8>(m_bounds.size()))
+    , m_tile_buildable(arena, m_bounds.area())
     , m_tile_sprite_offset(arena.allocate_array_2d<u8>(m_bounds.size()))
     , m_tile_sprite(arena.allocate_array_2d<SpriteRef>(m_bounds.size()))
     , m_tile_border_sprite(arena.allocate_array_2d<Optional<SpriteRef>>(m_bounds.size()))
+    , m_unsaved_sectors(arena, m_bounds)
 {
 }
 
@@ -55,6 +57,8 @@ void TerrainLayer::set_terrain_at(s32 x, s32 y, TerrainType type)
 
     // Set the terrain
     m_tile_terrain_type.set(x, y, type);
+    m_unsaved_sectors.mark_changed({ x, y, 1, 1 });
+    update_buildable_tiles({ x, y, 1, 1 });
 
     // Update sprites on this and neighbouring tiles
     Rect2I sprite_update_bounds = m_bounds.intersected({ x - 1, y - 1, 3, 3 });
@@ -64,6 +68,37 @@ void TerrainLayer::set_terrain_at(s32 x, s32 y, TerrainType type)
     update_distance_to_water({ x, y, 1, 1 });
 }
 
+bool TerrainLayer::can_build_at(s32 x, s32 y) const
+{
+    if (!m_bounds.contains(x, y))
+        return false;
+
+    return m_tile_buildable[(y * m_bounds.width()) + x];
+}
+
+u64 TerrainLayer::buildable_tiles_in_row(s32 x, s32 y, s32 count) const
+{
+    ASSERT(m_bounds.contains(Rect2I { x, y, count, 1 }));
+    return m_tile_buildable.get_bits((y * m_bounds.width()) + x, count);
+}
+
+void TerrainLayer::update_buildable_tiles(Rect2I bounds)
+{
+    bounds = m_bounds.intersected(bounds);
+    auto& terrain_catalogue = TerrainCatalogue::the();
+
+    for (s32 y = bounds.y(); y < bounds.y() + bounds.height(); y++) {
+        for (s32 x = bounds.x(); x < bounds.x() + bounds.width(); x++) {
+            s32 index = (y * m_bounds.width()) + x;
+            if (terrain_catalogue.get_def(m_tile_terrain_type.get(x, y)).canBuildOn) {
+                m_tile_buildable.set_bit(index);
+            } else {
+                m_tile_buildable.unset_bit(index);
+            }
+        }
+    }
+}
+
 u8 TerrainLayer::distance_to_water_at(s32 x, s32 y) const
 {
     return m_tile_distance_to_water.get(x, y);
@@ -192,6 +227,8 @@ void TerrainLayer::generate(City& city, u32 seed)
         }
     }
 
+    update_buildable_tiles(m_bounds);
+
     // Forest splats
     if (treeDef == nullptr) {
         logError("Map generator is unable to place any trees, because the 'tree' building was not found."_s);
@@ -209,7 +246,7 @@ void TerrainLayer::generate(City& city, u32 seed)
             Rect2I boundingBox = forestSplat.bounding_box().intersected(m_bounds);
             for (s32 y = boundingBox.y(); y < boundingBox.y() + boundingBox.height(); y++) {
                 for (s32 x = boundingBox.x(); x < boundingBox.x() + boundingBox.width(); x++) {
-                    if (terrain_at(x, y).canBuildOn
+                    if (can_build_at(x, y)
                         && (city.get_building_at(x, y) == nullptr)
                         && forestSplat.contains(x, y)) {
                         city.add_building(treeDef, { x, y, treeDef->size.x, treeDef->size.y });
@@ -340,13 +377,13 @@ void TerrainLayer::save(BinaryFileWriter& writer) const
     terrainSection.terrainTypeTable = writer.writeArray<SAVTerrainTypeEntry>(terrainTypeTable, terrainTypeTableLoc);
 
     // Tile terrain type (u8)
-    terrainSection.tileTerrainType = writer.appendBlob(&m_tile_terrain_type, FileBlobCompressionScheme::RLE_S8);
+    writer.appendBlob(&terrainSection.tileTerrainType, &m_tile_terrain_type, FileBlobCompressionScheme::Smallest, { .packValues = true }, m_unsaved_sectors.for_saving());
 
     // Tile height (u8)
-    terrainSection.tileHeight = writer.appendBlob(&m_tile_height, FileBlobCompressionScheme::RLE_S8);
+    writer.appendBlob(&terrainSection.tileHeight, &m_tile_height, FileBlobCompressionScheme::Smallest, { .rowLength = m_tile_height.width() }, m_unsaved_sectors.for_saving());
 
     // Tile sprite offset (u8)
-    terrainSection.tileSpriteOffset = writer.appendBlob(&m_tile_sprite_offset, FileBlobCompressionScheme::Uncompressed);
+    writer.appendBlob(&terrainSection.tileSpriteOffset, &m_tile_sprite_offset, FileBlobCompressionScheme::Smallest, {}, m_unsaved_sectors.for_saving());
 
     writer.endSection<SAVSection_Terrain>(&terrainSection);
 }
@@ -364,25 +401,37 @@ bool TerrainLayer::load(BinaryFileReader& reader)
         m_terrain_generation_seed = section->terrainGenerationSeed;
 
         // Map the file's terrain type IDs to the game's ones
-        // NB: count+1 because the file won't save the null terrain, so we need to compensate
-        Array<u8> oldTypeToNewType = reader.arena->allocate_filled_array<u8>(section->terrainTypeTable.count + 1);
-        Array<SAVTerrainTypeEntry> terrainTypeTable = reader.arena->allocate_array<SAVTerrainTypeEntry>(section->terrainTypeTable.count);
-        if (!reader.readArray(section->terrainTypeTable, &terrainTypeTable))
+        auto terrainTypeTable = reader.readArray<SAVTerrainTypeEntry>(section->terrainTypeTable);
+        if (!terrainTypeTable.has_value())
             break;
-        for (auto const& entry : terrainTypeTable) {
+        u32 highestTypeID = 0;
+        for (auto const& entry : terrainTypeTable.value())
+            highestTypeID = max<u32>(highestTypeID, entry.typeID);
+        if (highestTypeID > u8Max)
+            break;
+        Array<u8> oldTypeToNewType = reader.arena->allocate_filled_array<u8>(highestTypeID + 1);
+        for (auto const& entry : terrainTypeTable.value()) {
             String terrainName = reader.readString(entry.name);
             oldTypeToNewType[entry.typeID] = findTerrainTypeByName(terrainName);
         }
 
         // Terrain type
-        if (!reader.readBlob(section->tileTerrainType, &m_tile_terrain_type))
+        // This goes via a temporary array, because if this is a patch, it only covers some of the tiles,
+        // and the others have already been mapped. Files never contain the null terrain, so any tiles
+        // that are still null afterwards weren't in this file.
+        Array2<u8> fileTerrainType = reader.arena->allocate_array_2d<u8>(m_bounds.size());
+        if (!reader.readBlob(section->tileTerrainType, &fileTerrainType))
             break;
-        for (s32 y = 0; y < m_bounds.y(); y++) {
-            for (s32 x = 0; x < m_bounds.x(); x++) {
-                m_tile_terrain_type.set(x, y, oldTypeToNewType[m_tile_terrain_type.get(x, y)]);
+        for (s32 y = 0; y < m_bounds.height(); y++) {
+            for (s32 x = 0; x < m_bounds.width(); x++) {
+                u8 fileType = fileTerrainType.get(x, y);
+                if (fileType != 0)
+                    m_tile_terrain_type.set(x, y, (fileType < oldTypeToNewType.count()) ? oldTypeToNewType[fileType] : 0);
             }
         }
 
+        update_buildable_tiles(m_bounds);
+
         // Terrain height
         if (!reader.readBlob(section->tileHeight, &m_tile_height))
             break;
@@ -9,7 +9,9 @@
 #include <Gfx/Sprite.h>
 #include <IO/Forward.h>
 #include <Sim/Forward.h>
+#include <Sim/UnsavedSectors.h>
 #include <UI/Forward.h>
+#include <Util/BitArray.h>
 #include <Util/OccupancyArray.h>
 
 using TerrainType = u8;
@@ -30,6 +32,10 @@ public:
     TerrainType terrain_type_at(s32 x, s32 y) const;
     void set_terrain_at(s32 x, s32 y, TerrainType);
 
+    bool can_build_at(s32 x, s32 y) const;
+    // Bitmask of whether each of the `count` (max 64) tiles starting at (x,y) and going right can be built on.
+    u64 buildable_tiles_in_row(s32 x, s32 y, s32 count) const;
+
     u8 height_at(s32 x, s32 y) const;
 
     u8 distance_to_water_at(s32 x, s32 y) const;
@@ -37,11 +43,14 @@ public:
     void draw_terrain(Rect2I visible_area, s8 shader_id) const;
 
     void save(BinaryFileWriter&) const;
+    // Can be called again with a patch file, after loading the base file.
     bool load(BinaryFileReader&);
+    void clear_unsaved_sectors() { m_unsaved_sectors.clear(); }
 
 private:
     void update_distance_to_water(Rect2I bounds);
     void assign_terrain_sprites(Rect2I bounds);
+    void update_buildable_tiles(Rect2I bounds);
 
     Rect2I m_bounds;
 
@@ -50,10 +59,13 @@ private:
     Array2<TerrainType> m_tile_terrain_type;
     Array2<u8> m_tile_height;
     Array2<u8> m_tile_distance_to_water;
+    BitArray m_tile_buildable; // Cached TerrainDef::canBuildOn, indexed by (y * width) + x
 
     Array2<u8> m_tile_sprite_offset;
     Array2<SpriteRef> m_tile_sprite;
     Array2<Optional<SpriteRef>> m_tile_border_sprite;
+
+    UnsavedSectors m_unsaved_sectors; // For all the saved tile arrays
 };
 
 void show_terrain_window();
@@ -86,6 +86,9 @@ void TerrainCatalogue::remap_terrain_types(City& city)
         }
     }
 
+    // canBuildOn may have changed, even if no types were remapped.
+    city.terrainLayer.update_buildable_tiles(city.bounds);
+
     saveTerrainTypes();
 }
 
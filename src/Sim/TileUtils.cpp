@@ -44,7 +44,7 @@ void updateDistances(Array2<u8>* tileDistance, Rect2I dirtyRect, u8 maxDistance)
 }
 
 // @CopyPasta the other updateDistances().
-void updateDistances(Array2<u8>* tileDistance, DirtyRects* dirtyRects, u8 maxDistance)
+void updateDistances(Array2<u8>* tileDistance, DirtyRects const* dirtyRects, u8 maxDistance)
 {
     DEBUG_FUNCTION();
 
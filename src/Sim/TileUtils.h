@@ -73,4 +73,4 @@ s32 calculateDistanceTo(City* city, s32 x, s32 y, s32 maxDistanceToCheck, Filter
 }
 
 void updateDistances(Array2<u8>* tileDistance, Rect2I dirtyRect, u8 maxDistance);
-void updateDistances(Array2<u8>* tileDistance, DirtyRects* dirtyRects, u8 maxDistance);
+void updateDistances(Array2<u8>* tileDistance, DirtyRects const* dirtyRects, u8 maxDistance);
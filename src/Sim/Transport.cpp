@@ -12,7 +12,6 @@
 #include <UI/Panel.h>
 
 TransportLayer::TransportLayer(City& city, MemoryArena& arena)
-    : m_dirty_rects(arena, city.bounds)
 {
     m_tile_transport_types = arena.allocate_array_2d<Flags<TransportType>>(city.bounds.size());
 
@@ -26,7 +25,8 @@ void TransportLayer::update(City& city)
 {
     DEBUG_FUNCTION_T(DebugCodeDataTag::Simulation);
 
-    if (m_dirty_rects.is_dirty()) {
+    auto const& dirtyArea = city.dirty_area(m_transport_max_distance);
+    if (dirtyArea.is_dirty()) {
         // Calculate transport types on each tile
         // So, I have two ideas about this:
         // 1: memset the area to 0 and then iterate through all the buildings in that area, applying their transport types
@@ -37,7 +37,7 @@ void TransportLayer::update(City& city)
         // So, I think #2 is the better option, but I should test that later if it becomes expensive performance-wise.
         // - Sam, 28/08/2019
 
-        for (auto it = m_dirty_rects.rects().iterate();
+        for (auto it = dirtyArea.rects().iterate();
             it.hasNext();
             it.next()) {
             Rect2I dirtyRect = it.getValue();
@@ -68,18 +68,11 @@ void TransportLayer::update(City& city)
 
         // Transport distance recalculation
         for (auto type : enum_values<TransportType>()) {
-            updateDistances(&m_tile_transport_distance[type], &m_dirty_rects, m_transport_max_distance);
+            updateDistances(&m_tile_transport_distance[type], &dirtyArea, m_transport_max_distance);
         }
-
-        m_dirty_rects.clear();
     }
 }
 
-void TransportLayer::mark_dirty(Rect2I bounds)
-{
-    m_dirty_rects.mark_dirty(bounds.expanded(m_transport_max_distance));
-}
-
 bool TransportLayer::tile_has_transport(s32 x, s32 y, TransportType type) const
 {
     return m_tile_transport_types.get(x, y).has(type);
@@ -7,7 +7,6 @@
 #pragma once
 
 #include <IO/Forward.h>
-#include <Sim/DirtyRects.h>
 #include <Sim/Forward.h>
 #include <Sim/Layer.h>
 #include <Sim/Sector.h>
@@ -28,7 +27,7 @@ public:
     virtual ~TransportLayer() override = default;
 
     virtual void update(City&) override;
-    virtual void mark_dirty(Rect2I bounds) override;
+    virtual Optional<s32> dirty_area_radius() const override { return m_transport_max_distance; }
 
     void add_transport_to_tile(s32 x, s32 y, TransportType);
     void add_transport_to_tile(s32 x, s32 y, Flags<TransportType>);
@@ -45,8 +44,6 @@ public:
 
 private:
     u8 m_transport_max_distance { 8 };
-    DirtyRects m_dirty_rects;
-
     Array2<Flags<TransportType>> m_tile_transport_types;
 
     EnumMap<TransportType, Array2<u8>> m_tile_transport_distance;
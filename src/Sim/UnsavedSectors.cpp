@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "UnsavedSectors.h"
+#include <Util/Maths.h>
+#include <Util/MemoryArena.h>
+
+UnsavedSectors::UnsavedSectors(MemoryArena& arena, Rect2I bounds)
+    : m_bounds(bounds)
+    , m_sectors_wide(divideCeil(bounds.width(), sector_size))
+    , m_sectors_high(divideCeil(bounds.height(), sector_size))
+    , m_changed_sectors(arena, m_sectors_wide * m_sectors_high)
+{
+}
+
+void UnsavedSectors::mark_changed(Rect2I rect)
+{
+    rect = rect.intersected(m_bounds);
+    if (!rect.has_positive_area())
+        return;
+
+    s32 min_x = (rect.x() - m_bounds.x()) / sector_size;
+    s32 min_y = (rect.y() - m_bounds.y()) / sector_size;
+    s32 max_x = (rect.x() + rect.width() - 1 - m_bounds.x()) / sector_size;
+    s32 max_y = (rect.y() + rect.height() - 1 - m_bounds.y()) / sector_size;
+
+    for (s32 y = min_y; y <= max_y; y++)
+        m_changed_sectors.set_range((y * m_sectors_wide) + min_x, max_x - min_x + 1);
+}
+
+void UnsavedSectors::clear()
+{
+    m_changed_sectors.unset_all();
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2026, Sam Atkins <sam@samatkins.co.uk>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <IO/BinaryFile.h>
+#include <Util/Basic.h>
+#include <Util/BitArray.h>
+#include <Util/Rectangle.h>
+
+// Tracks which 16x16-tile sectors of a layer's tile arrays have changed since the city was last saved.
+// Autosaves use this to write patches containing only those sectors, instead of every tile again.
+class UnsavedSectors {
+public:
+    UnsavedSectors() = default;
+    UnsavedSectors(MemoryArena&, Rect2I bounds);
+
+    void mark_changed(Rect2I);
+    void clear();
+
+    FileChangedSectors for_saving() const { return { &m_changed_sectors, sector_size }; }
+
+private:
+    static constexpr s32 sector_size = 16;
+
+    Rect2I m_bounds;
+    s32 m_sectors_wide { 0 };
+    s32 m_sectors_high { 0 };
+    BitArray m_changed_sectors;
+};
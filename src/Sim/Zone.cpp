@@ -19,6 +19,7 @@
 ZoneLayer::ZoneLayer(City& city, MemoryArena& arena)
 {
     tileZone = arena.allocate_array_2d<ZoneType>(city.bounds.size());
+    unsavedSectors = { arena, city.bounds };
 
     sectors = SectorGrid<ZoneSector> { &arena, city.bounds.size(), 16, 8 };
     s32 sectorCount = sectors.sector_count();
@@ -73,25 +74,24 @@ CanZoneQuery queryCanZoneTiles(City* city, ZoneType zoneType, Rect2I input_bound
     // - Sam, 13/12/2018
 
     for (s32 y = bounds.y(); y < bounds.y() + bounds.height(); y++) {
-        for (s32 x = bounds.x(); x < bounds.x() + bounds.width(); x++) {
+        for (s32 x = bounds.x(); x < bounds.x() + bounds.width(); x += 64) {
+            s32 count = min(64, bounds.x() + bounds.width() - x);
 
-            // Ignore tiles that are already this zone!
-            if (city->zoneLayer.get_zone_at(x, y) == zoneType)
-                continue;
+            // Terrain must be buildable, and the tile must be empty
+            u64 candidate_tiles = city->terrainLayer.buildable_tiles_in_row(x, y, count) & ~city->occupied_tiles_in_row(x, y, count);
 
-            // Terrain must be buildable
-            // @Speed: URGH this terrain lookup for every tile is nasty!
-            if (!city->terrainLayer.terrain_at(x, y).canBuildOn)
-                continue;
+            for (; candidate_tiles != 0; candidate_tiles &= candidate_tiles - 1) {
+                s32 tile_x = x + count_trailing_zeros(candidate_tiles);
 
-            // Tile must be empty
-            if (city->building_exists_at(x, y))
-                continue;
+                // Ignore tiles that are already this zone!
+                if (city->zoneLayer.get_zone_at(tile_x, y) == zoneType)
+                    continue;
 
-            s32 relative_x = x - bounds.x();
-            s32 relative_y = y - bounds.y();
-            query.tileCanBeZoned.set(relative_x, relative_y, 1);
-            query.zoneableTilesCount++;
+                s32 relative_x = tile_x - bounds.x();
+                s32 relative_y = y - bounds.y();
+                query.tileCanBeZoned.set(relative_x, relative_y, 1);
+                query.zoneableTilesCount++;
+            }
         }
     }
 
@@ -157,23 +157,22 @@ void placeZone(City* city, ZoneType zoneType, Rect2I area)
 
     ZoneLayer* zoneLayer = &city->zoneLayer;
 
-    for (s32 y = area.y();
-        y < area.y() + area.height();
-        y++) {
-        for (s32 x = area.x();
-            x < area.x() + area.width();
-            x++) {
-            // Ignore tiles that are already this zone!
-            if ((zoneLayer->tileZone.get(x, y) != zoneType)
-                // Terrain must be buildable
-                // @Speed: URGH this terrain lookup for every tile is nasty!
-                && (city->terrainLayer.terrain_at(x, y).canBuildOn)
-                && (!city->building_exists_at(x, y))) {
-                zoneLayer->tileZone.set(x, y, zoneType);
+    for (s32 y = area.y(); y < area.y() + area.height(); y++) {
+        for (s32 x = area.x(); x < area.x() + area.width(); x += 64) {
+            s32 count = min(64, area.x() + area.width() - x);
+
+            // Terrain must be buildable, and the tile must be empty
+            u64 candidate_tiles = city->terrainLayer.buildable_tiles_in_row(x, y, count) & ~city->occupied_tiles_in_row(x, y, count);
+
+            for (; candidate_tiles != 0; candidate_tiles &= candidate_tiles - 1) {
+                s32 tile_x = x + count_trailing_zeros(candidate_tiles);
+                zoneLayer->tileZone.set(tile_x, y, zoneType);
             }
         }
     }
 
+    zoneLayer->unsavedSectors.mark_changed(area);
+
     // TODO: mark the affected zone sectors as dirty
 
     // Zones carry power!
@@ -606,7 +605,7 @@ void ZoneLayer::save(BinaryFileWriter& writer) const
     SAVSection_Zone zoneSection = {};
 
     // Tile zones
-    zoneSection.tileZone = writer.appendBlob(tileZone, FileBlobCompressionScheme::RLE_S8);
+    writer.appendBlob(&zoneSection.tileZone, tileZone, FileBlobCompressionScheme::Smallest, { .packValues = true }, unsavedSectors.for_saving());
 
     writer.endSection<SAVSection_Zone>(&zoneSection);
 }
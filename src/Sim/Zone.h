@@ -11,6 +11,7 @@
 #include <Sim/DirtyRects.h>
 #include <Sim/Forward.h>
 #include <Sim/Sector.h>
+#include <Sim/UnsavedSectors.h>
 #include <Util/BitArray.h>
 #include <Util/EnumMap.h>
 #include <Util/Flags.h>
@@ -72,9 +73,11 @@ public:
     u32 total_jobs() const;
 
     void save(BinaryFileWriter&) const;
+    // Can be called again with a patch file, after loading the base file.
     bool load(BinaryFileReader&);
 
     Array2<ZoneType> tileZone;
+    UnsavedSectors unsavedSectors; // For tileZone
     EnumMap<ZoneType, Array2<u8>> tileDesirability;
 
     SectorGrid<ZoneSector> sectors;